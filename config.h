@@ -2,13 +2,48 @@
 // Title:	        Pico-mposite Defines
 // Author:	        Dean Belfield
 // Created:	        01/03/2022
-// Last Updated:	27/09/2024
+// Last Updated:	17/10/2026
 //
 // Modinfo:
 // 27//09/2024:		Version 1.3
+// 17/10/2026:      Added opt_4bpp; options can now be overridden from the build
+// 17/10/2026:      Added opt_terminal_baud and opt_serial_buffer_size
+// 17/10/2026:      Added opt_terminal 2 for the terminal on core 1
+// 17/10/2026:      Added opt_ntsc
+// 17/10/2026:      Added opt_video_memory
+// 17/10/2026:      opt_video_memory now defaults to the largest mode the build uses
 
 #pragma once
 
 #define version         "1.3"
+
+#ifndef opt_colour
 #define opt_colour      0       // Set to 0 for monochrome board, 1 for colour board
-#define opt_terminal    0       // Set to 1 to just run the terminal software after boot screen
\ No newline at end of file
+#endif
+#ifndef opt_terminal
+#define opt_terminal    0       // Set to 1 to just run the terminal software after boot screen, 2 to run it on core 1 alongside graphics
+#endif
+#ifndef opt_4bpp
+#define opt_4bpp        0       // Set to 1 to pack two pixels into each byte of the bitmap (monochrome board only)
+#endif
+#ifndef opt_ntsc
+#define opt_ntsc        0       // Set to 1 to output NTSC timing (262 lines at 60Hz) rather than PAL (312 lines at 50Hz)
+#endif
+
+// Bytes of video memory for a bitmap of 192 lines; a display list and two line tables of 32-bit pointers, and the buffers
+//
+#define video_memory_for(w, buffers)    ((192 * 3 + 2) * 4 + (buffers) * (w) * (opt_4bpp ? 4 : 8) / 8 * 192)
+
+#ifndef opt_video_memory                // Bytes reserved for the bitmaps, display lists and video_memory_alloc; a multiple of 4
+#if opt_terminal == 0
+#define opt_video_memory        video_memory_for(256, 2)    // The demos use a double buffered 256x192 bitmap
+#else
+#define opt_video_memory        video_memory_for(640, 1)    // The terminal uses a 640x192 bitmap
+#endif
+#endif
+#ifndef opt_terminal_baud
+#define opt_terminal_baud       115200  // Baud rate for the terminal; the receive buffer is sized for up to 921600
+#endif
+#ifndef opt_serial_buffer_size
+#define opt_serial_buffer_size  8192    // Size of the serial receive buffer in bytes; must be a power of two
+#endif
@@ -3,7 +3,7 @@
 // Description:		The composite video stuff
 // Author:	        Dean Belfield
 // Created:	        26/01/2021
-// Last Updated:	27/09/2024
+// Last Updated:	17/10/2026
 //
 // Modinfo:
 // 15/02/2021:      Border buffers now have horizontal sync pulse set correctly
@@ -18,8 +18,25 @@
 // 20/02/2022:      Bitmap is now dynamically allocated; added two higher resolution video modes
 // 25/02/2022:      Lengthened HSYNC to 12us
 // 27/09/2024:		PIO state machines now started simultaneously
-
-#include <stdlib.h>
+// 17/10/2026:      Added double buffering; the scan-out buffer is swapped on line 1 by flip
+//                  Added packed 4bpp bitmap option
+//                  Sync is now fed by a control DMA channel from a table of scanlines, with one interrupt per frame
+//                  Pixel data is now fed by a control DMA channel from a table of bitmap lines; removed the PIO interrupt
+//                  Pixel data is now transferred 32 bits at a time
+//                  Added display lists, line doubled modes
+//                  Added hardware scrolling; commit_display_list no longer blocks
+//                  Added display batches
+//                  The display list swap is now guarded by a spin lock so the other core can commit
+//                  vblank_count is now volatile and exported
+//                  The sync line table and clock dividers are now built from a video timing descriptor; added NTSC
+//                  Added interlaced timings; the sync and pixel data chains are restarted for each field
+//                  The PIO clock dividers are now worked out from clk_sys for any width; added set_mode_width
+//                  The bitmaps and display lists are now laid out in the static video memory rather than allocated
+//                  wait_vblank and wait_flip now sleep until the interrupt sends an event; added vblank callbacks
+//                  initialise_cvideo panics if the timing is not valid or the clock dividers are out of range
+//                  The start of each field in the line table is worked out with the layout, not assumed
+//                  The PIO clock dividers are passed to the state machine set up in 16.8 fixed point
+//                  The pixel state machine is restarted without touching the clock divider of the sync state machine
 
 #include "memory.h"
 #include "pico/stdlib.h"
@@ -27,10 +44,13 @@
 #include "hardware/pio.h"
 #include "hardware/dma.h"
 #include "hardware/irq.h"   
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
 
 #include "charset.h"            // The character set
 #include "cvideo.h"
 #include "graphics.h"
+#include "video_memory.h"
 #include "cvideo_sync.pio.h"    // The assembled PIO code
 #include "cvideo_data.pio.h"
 
@@ -40,15 +60,50 @@ uint offset_1;
 
 uint dma_channel_0;             // DMA channel for transferring sync data to PIO
 uint dma_channel_1;             // DMA channel for transferring pixel data data to PIO
-uint vline;                     // Current PAL(ish) video line being processed
-uint bline;                     // Line in the bitmap to fetch
+uint dma_channel_2;             // DMA channel for reprogramming dma_channel_0 from the sync line table
+uint dma_channel_3;             // DMA channel for reprogramming dma_channel_1 from the bitmap line table
+
+volatile uint vblank_count;     // Vblank counter
+volatile uint32_t vblank_time;  // time_us_32 at the last vblank
+
+struct VblankCallback {
+    vblank_callback_t callback;     // The function, or NULL if this slot is free
+    void * data;                    // Passed to the function
+    bool deferred;                  // True if it is run by run_vblank_callbacks rather than the interrupt handler
+};
 
-uint vblank_count;              // Vblank counter
+struct VblankCallback vblank_callbacks[vblank_max_callbacks];
+uint vblank_deferred_frame;     // The vblank_count when run_vblank_callbacks last ran the deferred callbacks
 
-unsigned char * bitmap;         // Bitmap buffer
+unsigned char * bitmap;         // Bitmap buffer that the graphics primitives draw to
+unsigned char * bitmap_front;   // Bitmap buffer being scanned out; the same as bitmap if not double buffered
+
+bool double_buffered = false;   // True if double buffering is enabled
+volatile int swap_pending;      // Set by flip and commit_display_list, cleared by cvideo_dma_handler once swapped
+
+#define swap_display_list   1   // Flags for swap_pending
+#define swap_bitmap         2
+
+unsigned char ** display_list;      // The display list being edited; one bitmap line address per visible scanline
+unsigned char ** line_table;        // The display list being scanned out, one field after another, each terminated with NULL
+unsigned char ** line_table_back;   // The next display list, swapped in by cvideo_dma_handler
+int line_table_length;              // The number of entries in each line table
+int line_field_start[video_max_fields];     // The index in the line table of the first line of each field
+volatile bool data_restart;         // Set when the pixel data state machine needs starting at the next vblank
+spin_lock_t * display_lock;         // Guards line_table_back and swap_pending, as the display list can be committed from either core
 
 int width = 256;                // Bitmap dimensions             
 int height = 192;
+int stride = 256 * pixel_bits / 8;  // Bytes per row of the bitmap
+int display_lines = 192;        // Number of visible scanlines
+int scroll_offset = 0;          // The bitmap row shown at the top of the screen
+
+int video_flags = 0;            // The flags passed to set_mode_width
+struct VideoClocks video_clocks;
+int video_field = 0;            // The field being output
+
+int display_batch = 0;          // Nesting depth of begin_display_batch
+bool display_batch_commit;      // Set if commit_display_list was called during a batch
 
 /*
  * The sync tables consist of 32 entries, each one corresponding to a 2us slice of the 64us
@@ -93,23 +148,189 @@ unsigned short vsync_ls[32] = {
     VSLO, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, // Short sync pulse
 };
 
+// Vertical sync (short/long)
+//
+unsigned short vsync_sl[32] = {
+    VSLO, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, // Short sync pulse
+    VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSLO, VSHI, // Long sync pulse
+};
+
+// Vertical sync (short/blank)
+//
+unsigned short vsync_sb[32] = {
+    VSLO, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, // Short sync pulse
+    VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, // Blank
+};
+
+// Vertical sync (blank/short)
+//
+unsigned short vsync_bs[32] = {
+    HSLO, HSLO, HSHI, HSHI, HSHI, HSHI, HSHI, HSHI, HSHI, HSHI, HSHI, HSHI, HSHI, HSHI, HSHI, HSHI, // Horizontal sync, then blank
+    VSLO, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, VSHI, // Short sync pulse
+};
+
+/*
+ * The sync line table has one entry per scanline, each pointing to the sync table for that line.
+ * dma_channel_2 writes each entry in turn to the read address trigger of dma_channel_0, which chains back to
+ * dma_channel_2 once it has sent that line to the PIO. The NULL on the end stops the chain and raises the
+ * once-per-frame interrupt, where cvideo_dma_handler restarts it. An interlaced frame has two fields, each
+ * ending in a NULL, so the interrupt is taken once a field and the chain is restarted at the next one.
+ *
+ * The table is built from a video timing descriptor, which lists the scanlines of the frame as runs of sync
+ * patterns, along with the length of a scanline and of the line of pixels in it. The sync state machine takes
+ * 48 cycles for each of the 32 slices of a scanline, and the pixel data state machine 3 cycles per pixel, so
+ * the clock dividers are worked out from those and clk_sys by set_mode. They used to be constants that
+ * assumed a 125MHz clk_sys; this way the system clock can be changed, and the bitmap can be any width
+ */
+unsigned short * sync_line_table[video_max_lines + video_max_fields];
+unsigned short ** sync_field_start[video_max_fields];  // The start of each field in the sync line table
+
+const struct VideoTiming * video_timing;
+
+// PAL(ish); 312 lines of 64.5us, so about 50Hz
+//
+const struct VideoTiming video_timing_pal = {
+    .name = "PAL",
+    .rate = 50,
+    .fields = 1,
+    .line_ns = 64512,           // 32 slices of 2.016us
+    .active_ns = 43008,
+    .runs = {
+        {   2, sync_ll },
+        {   1, sync_ls },
+        {   2, sync_ss },
+        {  63, sync_border },
+        { 192, sync_active },
+        {  49, sync_border },
+        {   3, sync_ss },
+    },
+};
+
+// NTSC; 262 lines of 63.6us, so about 60Hz
+// The vertical sync is three lines each of equalising, serrated and equalising pulses
+//
+const struct VideoTiming video_timing_ntsc = {
+    .name = "NTSC",
+    .rate = 60,
+    .fields = 1,
+    .line_ns = 63556,
+    .active_ns = 42370,         // The PAL line of pixels scaled to the shorter line, so the picture is the same width
+    .runs = {
+        {   3, sync_ss },
+        {   3, sync_ll },
+        {   3, sync_ss },
+        {  36, sync_border },
+        { 192, sync_active },
+        {  25, sync_border },
+    },
+};
+
+// PAL interlaced; 625 lines in two fields of 312.5, with 192 active lines in each
+// The second field starts half way along line 313, and starts its active lines one line later, so its lines
+// fall half way between those of the first
+//
+const struct VideoTiming video_timing_pal_interlaced = {
+    .name = "PAL interlaced",
+    .rate = 50,
+    .fields = 2,
+    .line_ns = 64512,
+    .active_ns = 43008,
+    .runs = {
+        {   2, sync_ll },       // Lines 1 to 312
+        {   1, sync_ls },
+        {   2, sync_ss },
+        {  63, sync_border },
+        { 192, sync_active },
+        {  49, sync_border },
+        {   3, sync_ss },
+        {   0 },
+        {   1, sync_sl },       // Lines 313 to 625
+        {   2, sync_ll },
+        {   2, sync_ss },
+        {   1, sync_sb },
+        {  63, sync_border },
+        { 192, sync_active },
+        {  49, sync_border },
+        {   1, sync_bs },
+        {   2, sync_ss },
+    },
+};
+
+// NTSC interlaced; 525 lines in two fields of 262.5, with 240 active lines in each
+//
+const struct VideoTiming video_timing_ntsc_interlaced = {
+    .name = "NTSC interlaced",
+    .rate = 60,
+    .fields = 2,
+    .line_ns = 63556,
+    .active_ns = 42370,
+    .runs = {
+        {   3, sync_ss },       // Lines 1 to 263
+        {   3, sync_ll },
+        {   3, sync_ss },
+        {  12, sync_border },
+        { 240, sync_active },
+        {   1, sync_border },
+        {   1, sync_bs },
+        {   0 },
+        {   2, sync_ss },       // Lines 264 to 525
+        {   1, sync_sl },
+        {   2, sync_ll },
+        {   1, sync_ls },
+        {   2, sync_ss },
+        {   1, sync_sb },
+        {  12, sync_border },
+        { 240, sync_active },
+        {   1, sync_border },
+    },
+};
+
+/*
+ * The display list works in the same way for the pixel data; dma_channel_3 writes the address of the bitmap
+ * line for each visible scanline in turn to dma_channel_1, which chains back to dma_channel_3 once it has sent
+ * that line. The pixel data state machine counts the pixels out, so the next line can be queued in the FIFO
+ * while the current one is being output. The chain is restarted by cvideo_dma_handler.
+ *
+ * As each scanline can point at any line of any buffer, the display list can be used for split screens,
+ * line doubling and scrolling without moving any pixels
+ */
+
 /*
  * The main routine sets up the whole shebang
  */
 int initialise_cvideo(void) { 
+    video_timing = opt_ntsc ? &video_timing_ntsc : &video_timing_pal;
+    display_lines = cvideo_check_timing(video_timing);
+    if(display_lines < 0) {
+        panic("cvideo: the video timing is not valid");
+    }
+    video_clocks.sys_hz = clock_get_hz(clk_sys);
+    video_clocks.sync_clkdiv = cvideo_clkdiv(video_timing->line_ns, sync_cycles_line, &video_clocks.line_error);
+    video_clocks.data_clkdiv = cvideo_clkdiv(video_timing->active_ns, width * data_cycles_pixel, &video_clocks.pixel_error);
+    if(video_clocks.sync_clkdiv == 0 || video_clocks.data_clkdiv == 0) {    // A divider of 0 would run the PIO at clk_sys / 65536
+        panic("cvideo: clk_sys of %u Hz is out of range for a %d pixel wide bitmap", (uint)video_clocks.sys_hz, width);
+    }
+
     pio_0 = pio0;	                    // Assign the PIO
 
     // Load up the PIO programs
     //
     offset_0 = pio_add_program(pio_0, &cvideo_sync_program);
+    #if opt_4bpp == 1
+    offset_1 = pio_add_program(pio_0, &cvideo_data_4bpp_program);
+    #else
     offset_1 = pio_add_program(pio_0, &cvideo_data_program);
+    #endif
 
     dma_channel_0 = dma_claim_unused_channel(true);	// Claim a DMA channel for the sync
     dma_channel_1 = dma_claim_unused_channel(true);	// And one for the pixel data
+    dma_channel_2 = dma_claim_unused_channel(true);	// And one to feed the sync channel with scanlines
+    dma_channel_3 = dma_claim_unused_channel(true);	// And one to feed the pixel data channel with bitmap lines
 
-    vline = 1;          // Initialise the video scan line counter to 1
-    bline = 0;	        // And the index into the bitmap pixel buffer to 0
-    vblank_count = 0;   // And the vblank counter
+    cvideo_build_sync_table();
+
+    vblank_count = 0;   // Initialise the vblank counter
+    vblank_deferred_frame = 0;
 
 	// Initialise the first PIO (video sync)
 	//
@@ -121,29 +342,55 @@ int initialise_cvideo(void) {
 		offset_0,								// And offset
 		gpio_base,								// Start pin in the GPIO
 		gpio_count,								// Number of pins
-		piofreq_0								// State machine clock frequency
+		video_clocks.sync_clkdiv				// State machine clock divider
 	);	
     cvideo_configure_pio_dma(					// Configure the DMA
         pio_0,									// The PIO to attach this DMA to
         sm_sync,								// The state machine number
         dma_channel_0,							// The DMA channel
+        dma_channel_2,                          // Chained to the control channel
         DMA_SIZE_16,                            // Size of each transfer
         32,										// Number of bytes to transfer
         cvideo_dma_handler						// The DMA handler
     );
+    cvideo_configure_control_dma(               // Configure the control DMA
+        dma_channel_2,                          // The DMA channel
+        dma_channel_0                           // The channel it feeds with scanlines
+    );
 
-    bitmap = malloc(width * height);            // Allocate the bitmap memory
+    struct VideoLayout layout;                  // Lay out the bitmap and display lists in the video memory
+    if(!cvideo_plan_mode(&layout, width, 0, video_timing)) {
+        return -1;
+    }
+    cvideo_use_layout(&layout, display_lines + video_timing->fields);
+    swap_pending = 0;
+    display_lock = spin_lock_init(spin_lock_claim_unused(true));
+    reset_display_list();
+    cvideo_copy_display_list(line_table);
 
 	// Initialise the second PIO (pixel data)
 	//
+    #if opt_4bpp == 1
+    cvideo_data_4bpp_initialise_pio(
+		pio_0,
+		sm_data,
+		offset_1,
+		gpio_base,
+		gpio_count_4bpp,
+		video_clocks.data_clkdiv
+	);
+    #else
     cvideo_data_initialise_pio(					
 		pio_0,
 		sm_data,
 		offset_1,
 		gpio_base,
 		gpio_count,
-		piofreq_1_256
+		video_clocks.data_clkdiv
 	);
+    #endif
+
+    cvideo_data_set_width(pio_0, sm_data, offset_1, width);
 
     // Initialise the DMA
     //
@@ -151,70 +398,470 @@ int initialise_cvideo(void) {
         pio_0,	
         sm_data,
         dma_channel_1,							// On DMA channel 1
-        DMA_SIZE_8,                             // Size of each transfer
-        width,									// The bitmap width
+        dma_channel_3,                          // Chained to the control channel
+        DMA_SIZE_32,                            // Size of each transfer
+        stride / 4,								// The bitmap width in words
         NULL									// But there is no DMA interrupt for the pixel data
     ); 
-
-    irq_set_exclusive_handler(					// Set up the PIO IRQ handler
-		PIO0_IRQ_0,								// The IRQ #
-		cvideo_pio_handler						// And handler routine
-	); 
-    pio0_hw->inte0 = PIO_IRQ0_INTE_SM0_BITS;	// Just for IRQ 0 (triggered by irq set 0 in PIO)
-    irq_set_enabled(PIO0_IRQ_0, true);			// Enable it    
+    cvideo_configure_control_dma(
+        dma_channel_3,
+        dma_channel_1
+    );
 
     set_border(0);                              // Set the border colour
     cls(0);                                     // Clear the screen      
 
-	// Start the PIO state machines
+	// Start the sync chain and state machine; the pixel data is started in step by the first vblank
 	//
-	pio_enable_sm_mask_in_sync(pio_0, (1u << sm_data) | (1u << sm_sync));
+    data_restart = true;
+    dma_channel_set_read_addr(dma_channel_2, sync_field_start[0], true);
+	pio_enable_sm_mask_in_sync(pio_0, 1u << sm_sync);
     return 0;
 }
 
 // Set the graphics mode
-// mode - The graphics mode (0 = 256x192, 1 = 320 x 192, 2 = 640 x 192)
+// mode - The graphics mode (0 = 256x192, 1 = 320 x 192, 2 = 640 x 192); the height is display_lines, so is
+//        384 or 480 with an interlaced video timing
+//        Add mode_line_double for a bitmap of half the height with each line shown twice
+// Returns:
+// - 0 if successful, -1 if the mode is not supported
 //
 int set_mode(int mode) {
-    double dfreq;
+    int w;
 
-    wait_vblank();
-
-    switch(mode) {                              // Get the video mode
+    switch(mode & mode_width_mask) {            // Get the screen width for the video mode
         case 1: 
-            width = 320;                        // Set screen width and
-            dfreq = piofreq_1_320;              // pixel dot frequency accordingly
+            w = 320;
             break;
         case 2: 
-            width = 640;                
-            dfreq = piofreq_1_640;
+            w = 640;                
             break;
         default:
-            width = 256;
-            dfreq = piofreq_1_256;
+            w = 256;
             break;            
-
     }
+    return set_mode_width(w, mode & ~mode_width_mask);
+}
+
+// Set the graphics mode to any width
+// The pixel clock is worked out so the line of pixels is the same length on screen whatever the width, from the
+// current clk_sys, so this should be called again after changing the system clock
+// - w: The width in pixels; a whole number of words of the bitmap
+// - flags: mode_line_double for a bitmap of half the height with each line shown twice, or 0
+// Returns:
+// - 0 if successful, -1 if the width is not supported or there is not enough video memory, in which case the
+//   mode is not changed
+//
+int set_mode_width(int w, int flags) {
+    struct VideoClocks clocks;
+    struct VideoLayout layout;
 
-    if(bitmap != NULL) {
-        free(bitmap);
+    if(!cvideo_check_width(w)) {                // The pixel DMA works in whole words
+        return -1;
+    }
+    if(!cvideo_plan_mode(&layout, w, flags, video_timing)) {    // And the bitmap must fit in the video memory
+        return -1;
     }
-    bitmap = malloc(width * height);            // Allocate the bitmap memory
+    clocks.sys_hz = clock_get_hz(clk_sys);      // And the pixel clock can be no faster than clk_sys / 3
+    clocks.sync_clkdiv = cvideo_clkdiv(video_timing->line_ns, sync_cycles_line, &clocks.line_error);
+    clocks.data_clkdiv = cvideo_clkdiv(video_timing->active_ns, w * data_cycles_pixel, &clocks.pixel_error);
+    if(clocks.sync_clkdiv == 0 || clocks.data_clkdiv == 0) {
+        return -1;
+    }
+
+    wait_vblank();
+
+    pio_sm_set_enabled(pio_0, sm_data, false);  // Stop the pixel data until the next vblank
+    dma_channel_abort(dma_channel_3);
+    dma_channel_abort(dma_channel_1);
+
+    video_flags = flags;
+    width = w;
+    height = flags & mode_line_double ? display_lines / 2 : display_lines;
+    stride = width * pixel_bits / 8;
+    scroll_offset = 0;
+
+    swap_pending = 0;                           // Cancel any outstanding flip
+    cvideo_use_layout(&layout, display_lines + video_timing->fields);   // Move the buffers
+    reset_display_list();                       // Set up the default display list for this mode
+    cvideo_copy_display_list(line_table);       // And scan that out straight away
+    cvideo_rebase_display_list(line_table, line_table_length, bitmap, bitmap_front);
 
     cvideo_configure_pio_dma(                   // Reconfigure the DMA
         pio_0,	
         sm_data,
         dma_channel_1,							// On DMA channel 1
-        DMA_SIZE_8,                             // Size of each transfer
-        width,									// The bitmap width
+        dma_channel_3,                          // Chained to the control channel
+        DMA_SIZE_32,                            // Size of each transfer
+        stride / 4,								// The bitmap width in words
         NULL									// But there is no DMA interrupt for the pixel data
     ); 
 
-    pio_0->sm[sm_data].clkdiv = (uint32_t) (dfreq * (1 << 16));
+    cvideo_data_set_width(pio_0, sm_data, offset_1, width);
+    pio_0->sm[sm_data].clkdiv = clocks.data_clkdiv;
+    pio_0->sm[sm_sync].clkdiv = clocks.sync_clkdiv; // In case clk_sys has changed
+    video_clocks = clocks;
+    data_restart = true;                        // Restart the pixel data at the next vblank
+
+    return 0;
+}
+
+// Check whether a bitmap width can be scanned out
+// The pixel data is transferred a word at a time, so each line must be a whole number of words
+// - w: The width in pixels
+// Returns:
+// - true if the width is supported
+//
+bool cvideo_check_width(int w) {
+    return w > 0 && (w * pixel_bits / 8) % 4 == 0;
+}
+
+// Work out a PIO clock divider from clk_sys
+// - ns: The length of time to fill, in nanoseconds
+// - cycles: The number of state machine cycles in that time
+// - error: Set to the error in the time actually taken, in parts per million
+// Returns:
+// - The divider in 16.8 fixed point in the top 24 bits, as written to the clkdiv register, or 0 if out of range
+//
+uint32_t cvideo_clkdiv(uint32_t ns, uint32_t cycles, int * error) {
+    double div = (double)ns * clock_get_hz(clk_sys) / ((double)cycles * 1e9);
+    if(div < 1 || div >= 65536) {
+        return 0;
+    }
+    uint32_t d = (uint32_t)(div * 256 + 0.5);   // The fractional part is in 256ths
+    *error = (int)((d / 256.0 / div - 1) * 1e6);
+    return d << 8;
+}
+
+// Set the video standard
+// The sync is stopped and restarted with the new timing, and the current mode is set up again, as the
+// number of visible scanlines may have changed, so the bitmap needs redrawing afterwards
+// - timing: The timing descriptor, for example &video_timing_ntsc
+// Returns:
+// - 0 if successful, -1 if the timing is not valid
+//
+int set_video_timing(const struct VideoTiming * timing) {
+    int lines = cvideo_check_timing(timing);
+    int error;
+    uint32_t sync_clkdiv = cvideo_clkdiv(timing->line_ns, sync_cycles_line, &error);
+    struct VideoLayout layout;
+    if(lines < 0 || sync_clkdiv == 0 || !cvideo_plan_mode(&layout, width, video_flags, timing)) {
+        return -1;                              // The current mode must fit with the new number of scanlines too
+    }
+
+    wait_vblank();
+
+    irq_set_enabled(DMA_IRQ_0, false);          // Stop the video while the sync line table is rebuilt
+    pio_sm_set_enabled(pio_0, sm_sync, false);
+    pio_sm_set_enabled(pio_0, sm_data, false);
+    dma_channel_abort(dma_channel_2);
+    dma_channel_abort(dma_channel_0);
+    dma_channel_abort(dma_channel_3);
+    dma_channel_abort(dma_channel_1);
+    dma_hw->ints0 = 1u << dma_channel_0;        // Clear any interrupt raised by the abort
+
+    video_timing = timing;
+    video_field = 0;
+    display_lines = lines;
+    cvideo_build_sync_table();
+
+    pio_sm_clear_fifos(pio_0, sm_sync);         // Start the sync state machine from the top at the new rate
+    pio_sm_restart(pio_0, sm_sync);
+    pio_sm_exec(pio_0, sm_sync, pio_encode_jmp(offset_0));
+    pio_0->sm[sm_sync].clkdiv = sync_clkdiv;
+
+    irq_set_enabled(DMA_IRQ_0, true);
+    dma_channel_set_read_addr(dma_channel_2, sync_field_start[0], true);
+    pio_enable_sm_mask_in_sync(pio_0, 1u << sm_sync);
 
+    return set_mode_width(width, video_flags);  // Set the mode up again for the new number of scanlines
+}
+
+// Check a video timing descriptor
+// - timing: The timing descriptor
+// Returns:
+// - The number of visible scanlines, or -1 if the frame is too long or each field does not have one run of
+//   active lines of the same length
+//
+int cvideo_check_timing(const struct VideoTiming * timing) {
+    int lines = 0;
+    int active = -1;
+    int run = 0;
+
+    if(timing->fields < 1 || timing->fields > video_max_fields) {
+        return -1;
+    }
+    for(int f = 0; f < timing->fields; f++, run++) {
+        int field_active = -1;
+        for(; run < video_max_runs && timing->runs[run].count > 0; run++) {
+            const struct SyncRun * r = &timing->runs[run];
+            if(r->type > sync_active) {
+                return -1;
+            }
+            if(r->type == sync_active) {
+                if(field_active >= 0) {
+                    return -1;
+                }
+                field_active = r->count;
+            }
+            lines += r->count;
+        }
+        if(field_active < 0 || (active >= 0 && field_active != active)) {
+            return -1;
+        }
+        active = field_active;
+    }
+    return lines <= video_max_lines ? active * timing->fields : -1;
+}
+
+// Enable or disable double buffering
+// When enabled the graphics primitives draw to a back buffer which is shown by calling flip
+// - enabled: True to enable double buffering, false to disable it
+// Returns:
+// - 0 if successful, -1 if there is not enough memory for a second buffer in the current mode
+//
+int set_double_buffer(bool enabled) {
+    if(enabled == double_buffered) {
+        return 0;
+    }
+    wait_flip();                                // Make sure there are no flips outstanding
+    struct VideoLayout layout;                  // The front buffer and display lists stay where they are
+    if(!video_memory_plan(&layout, stride, height, display_lines, line_table_length, enabled)) {
+        return -1;                              // Not enough room for the back buffer
+    }
+    if(enabled) {
+        memcpy(layout.back, bitmap_front, stride * height); // Start with a copy of what is on screen
+        cvideo_rebase_display_list(display_list, display_lines, bitmap_front, layout.back);
+        bitmap = layout.back;                   // And draw to that from now on
+    }
+    else {
+        if(bitmap_front != layout.bitmap) {     // If the buffers have been swapped, copy what is on screen to the one kept
+            memcpy(layout.bitmap, bitmap_front, stride * height);
+        }
+        cvideo_rebase_display_list(display_list, display_lines, bitmap, layout.bitmap);
+        bitmap = layout.bitmap;
+        if(bitmap_front != layout.bitmap) {     // And scan that out before the other is given up
+            bitmap_front = layout.bitmap;
+            commit_display_list(true);
+        }
+    }
+    video_memory_commit(&layout);
+    double_buffered = enabled;
     return 0;
 }
 
+// Get the video memory needed for a mode with the current video timing
+// - w, flags: As for set_mode_width
+// - double_buffered: True to include the back buffer
+// Returns:
+// - The size in bytes
+//
+uint32_t mode_memory_size(int w, int flags, bool double_buffered) {
+    int h = flags & mode_line_double ? display_lines / 2 : display_lines;
+
+    return video_layout_size(w * pixel_bits / 8, h, display_lines, display_lines + video_timing->fields, double_buffered);
+}
+
+// Work out where a mode goes in the video memory
+// If double buffered and there is not enough room for the back buffer, this falls back to a single buffer
+// - layout: Filled in with the layout
+// - w, flags: As for set_mode_width
+// - timing: The video timing
+// Returns:
+// - false if the mode does not fit even with a single buffer
+//
+bool cvideo_plan_mode(struct VideoLayout * layout, int w, int flags, const struct VideoTiming * timing) {
+    int lines = cvideo_check_timing(timing);
+    int h = flags & mode_line_double ? lines / 2 : lines;
+    int s = w * pixel_bits / 8;
+
+    if(double_buffered && video_memory_plan(layout, s, h, lines, lines + timing->fields, true)) {
+        return true;
+    }
+    return video_memory_plan(layout, s, h, lines, lines + timing->fields, false);
+}
+
+// Start using a layout of the video memory
+// The video must be stopped, as the buffers and display lists move
+// - layout: The layout, from cvideo_plan_mode
+// - length: The number of entries in each line table
+//
+void cvideo_use_layout(const struct VideoLayout * layout, int length) {
+    video_memory_commit(layout);
+    display_list = layout->display_list;
+    line_table = layout->line_table;
+    line_table_back = layout->line_table_back;
+    line_table_length = length;
+    for(int f = 0, i = 0; f < video_timing->fields; f++) {  // Each field is every fields'th line from f, and a NULL
+        line_field_start[f] = i;
+        i += (display_lines - f + video_timing->fields - 1) / video_timing->fields + 1;
+    }
+    bitmap_front = layout->bitmap;
+    bitmap = layout->back != NULL ? layout->back : layout->bitmap;
+    double_buffered = layout->back != NULL;
+}
+
+// Show the back buffer
+// The buffers and display list are swapped at the start of the next frame, so there is no tearing. If not double
+// buffered, this just commits the display list
+// - wait: True to block until the buffers have been swapped. If false this returns immediately,
+//         and wait_flip must be called before drawing to the bitmap again
+//
+void flip(bool wait) {
+    wait_flip();                                // Only one flip can be outstanding at any time
+    cvideo_copy_display_list(line_table_back);
+    if(double_buffered) {
+        cvideo_rebase_display_list(display_list, display_lines, bitmap, bitmap_front); // Keep editing relative to the next back buffer
+        swap_pending = swap_display_list | swap_bitmap;
+    }
+    else {
+        swap_pending = swap_display_list;
+    }
+    if(wait) {
+        wait_flip();
+    }
+}
+
+// Wait for an outstanding flip or display list commit to complete
+//
+void wait_flip(void) {
+    while(swap_pending) {
+        __wfe();                                // Sleep until the next event; cvideo_dma_handler sends one every vblank
+    }
+}
+
+// Reset the display list
+// Each visible scanline shows the corresponding line of the bitmap, with lines repeated if the bitmap
+// is shorter than the display (for example in the line doubled modes)
+//
+void reset_display_list(void) {
+    for(int i = 0; i < display_lines; i++) {
+        display_list[i] = &bitmap[stride * (i * height / display_lines)];
+    }
+}
+
+// Point a run of visible scanlines at lines in a buffer
+// Buffers must be word aligned and have the same stride as the bitmap
+// - line: The first visible scanline (0 to display_lines - 1)
+// - count: The number of scanlines
+// - buffer: The buffer to show, for example bitmap
+// - row: The first line of the buffer to show
+// - rows: The number of lines in the buffer; row wraps around at this, so rotating row scrolls the buffer
+// - repeat: The number of scanlines to show each line of the buffer on (1 for normal, 2 for line doubling)
+//
+void set_display_lines(int line, int count, unsigned char * buffer, int row, int rows, int repeat) {
+    if(line < 0 || count <= 0 || rows <= 0 || repeat <= 0) {
+        return;
+    }
+    if(line + count > display_lines) {
+        count = display_lines - line;
+    }
+    row %= rows;
+    if(row < 0) {
+        row += rows;
+    }
+    for(int i = 0; i < count; i++) {
+        display_list[line + i] = &buffer[stride * row];
+        if((i + 1) % repeat == 0 && ++row >= rows) {
+            row = 0;
+        }
+    }
+}
+
+// Commit the display list
+// The new display list is swapped in at the start of the next frame. If the previous one has not been
+// swapped in yet it is replaced, so this can be called more than once a frame without blocking
+// - wait: True to block until it has been swapped in
+//
+void commit_display_list(bool wait) {
+    if(display_batch > 0) {                     // Leave it to end_display_batch
+        display_batch_commit = true;
+        return;
+    }
+    if(swap_pending & swap_bitmap) {            // Wait for any flip, as that changes which buffer is which
+        wait_flip();
+    }
+    uint32_t status = spin_lock_blocking(display_lock);   // Keep cvideo_dma_handler out while the table is written
+    cvideo_copy_display_list(line_table_back);
+    cvideo_rebase_display_list(line_table_back, line_table_length, bitmap, bitmap_front);
+    swap_pending = swap_display_list;
+    spin_unlock(display_lock, status);
+    if(wait) {
+        wait_flip();
+    }
+}
+
+// Start a batch of display list changes
+// Any commits until the matching end_display_batch are held back and done once at the end, so for example
+// a run of scrolls only rebuilds the scan-out table once. Batches can be nested
+//
+void begin_display_batch(void) {
+    display_batch++;
+}
+
+// End a batch of display list changes
+// Commits the display list if it was committed during the batch
+//
+void end_display_batch(void) {
+    if(display_batch > 0 && --display_batch == 0 && display_batch_commit) {
+        display_batch_commit = false;
+        commit_display_list(false);
+    }
+}
+
+// Set the hardware scroll
+// The display list is rebuilt to show the bitmap starting at this row, wrapping around at the bottom, so
+// the bitmap can be scrolled without moving any pixels. The primitives address the bitmap through
+// bitmap_row, so screen coordinates are unaffected
+// - offset: The bitmap row to show at the top of the screen
+//
+void set_scroll(int offset) {
+    offset %= height;
+    if(offset < 0) {
+        offset += height;
+    }
+    scroll_offset = offset;
+    set_display_lines(0, display_lines, bitmap, offset, height, display_lines / height);
+    commit_display_list(false);
+}
+
+// Copy the display list being edited to a line table for scan-out
+// The lines are sorted into fields, so an interlaced frame scans out alternate lines in each field
+// - table: The line table; this needs line_table_length entries
+//
+void cvideo_copy_display_list(unsigned char ** table) {
+    int fields = video_timing->fields;
+
+    if(fields == 1) {
+        memcpy(table, display_list, display_lines * sizeof(unsigned char *));
+        table[display_lines] = NULL;        // Terminate the chain
+        return;
+    }
+    for(int f = 0; f < fields; f++) {
+        for(int i = f; i < display_lines; i += fields) {
+            *table++ = display_list[i];
+        }
+        *table++ = NULL;                    // Terminate the chain for each field
+    }
+}
+
+// Move the entries in a display list that point into one bitmap buffer to the same lines in another
+// - table: The display list or line table
+// - count: The number of entries in the table
+// - from: The buffer to move from
+// - to: The buffer to move to
+//
+void cvideo_rebase_display_list(unsigned char ** table, int count, unsigned char * from, unsigned char * to) {
+    if(from == to) {
+        return;
+    }
+    for(int i = 0; i < count; i++) {
+        if(table[i] >= from && table[i] < from + stride * height) {
+            table[i] = to + (table[i] - from);
+        }
+    }
+}
+
 // Set the border colour
 // - colour: Border colour
 //
@@ -232,76 +879,196 @@ void set_border(unsigned char colour) {
     }
 }
 
+/*
+ * Rather than polling, anything waiting for a vblank sleeps with __wfe until cvideo_dma_handler wakes both cores
+ * with __sev. An interrupt or another event can also end the sleep early, so the wait is always in a loop that
+ * checks the condition again. Callbacks can be run every vblank, either by the interrupt handler itself, in which
+ * case they must be quick, or deferred to whichever core calls run_vblank_callbacks in its main loop
+ */
+
 // Wait for vblank
 //
 void wait_vblank(void) {
     uint c = vblank_count;                      // Get the current vblank count
     while(c == vblank_count) {                  // Wait until it changes
-        sleep_us(4);                            // Need to sleep for a minimum of 4us
+        __wfe();
+    }
+}
+
+// Wait for a frame, for frame pacing
+// - frame: The value of vblank_count to wait for, for example the frame a render started on plus two for 30Hz
+// Returns:
+// - The number of frames late; 0 if this had to wait, more if that frame had already passed, in which case the
+//   caller can skip frames to catch up
+//
+uint wait_frame(uint frame) {
+    while((int)(vblank_count - frame) < 0) {
+        __wfe();
     }
+    return vblank_count - frame;
 }
 
-// The PIO interrupt handler
-// This sets up the DMA for cvideo_data with pixel data and is triggered by the irq set 0
-// instruction at the end of the PIO
+// Get the frame count and the time of the last vblank together
+// - time: Set to time_us_32 at the start of that vblank, or NULL
+// Returns:
+// - The vblank count
 //
-void cvideo_pio_handler(void) {
-    if(bline >= height) {
-        bline = 0;
+uint get_frame(uint32_t * time) {
+    uint frame;
+    uint32_t t;
+
+    do {                                        // Read again if a vblank comes in between
+        frame = vblank_count;
+        t = vblank_time;
+    } while(frame != vblank_count);
+    if(time != NULL) {
+        *time = t;
+    }
+    return frame;
+}
+
+// Add a vblank callback
+// - callback: The function, called with the vblank count and data
+// - data: Passed to the function
+// - deferred: False to run it in the interrupt handler, where it must be quick and not wait for anything,
+//             including commit_display_list(true) or flip(true); true to run it from run_vblank_callbacks
+// Returns:
+// - 0 if successful, -1 if there are already vblank_max_callbacks
+//
+int add_vblank_callback(vblank_callback_t callback, void * data, bool deferred) {
+    int result = -1;
+    uint32_t status = spin_lock_blocking(display_lock);     // Keep the interrupt handler out, on either core
+    for(int i = 0; i < vblank_max_callbacks; i++) {
+        if(vblank_callbacks[i].callback == NULL) {
+            vblank_callbacks[i] = (struct VblankCallback){ callback, data, deferred };
+            result = 0;
+            break;
+        }
+    }
+    spin_unlock(display_lock, status);
+    return result;
+}
+
+// Remove a vblank callback
+// - callback, data: As passed to add_vblank_callback
+//
+void remove_vblank_callback(vblank_callback_t callback, void * data) {
+    uint32_t status = spin_lock_blocking(display_lock);
+    for(int i = 0; i < vblank_max_callbacks; i++) {
+        if(vblank_callbacks[i].callback == callback && vblank_callbacks[i].data == data) {
+            vblank_callbacks[i].callback = NULL;
+        }
+    }
+    spin_unlock(display_lock, status);
+}
+
+// Copy the callbacks to run, so they can be called without holding the lock
+// - list: Filled in with the callbacks
+// - deferred: Which callbacks to copy
+// Returns:
+// - The number of callbacks copied
+//
+static int cvideo_get_callbacks(struct VblankCallback * list, bool deferred) {
+    int count = 0;
+    uint32_t status = spin_lock_blocking(display_lock);
+    for(int i = 0; i < vblank_max_callbacks; i++) {
+        if(vblank_callbacks[i].callback != NULL && vblank_callbacks[i].deferred == deferred) {
+            list[count++] = vblank_callbacks[i];
+        }
+    }
+    spin_unlock(display_lock, status);
+    return count;
+}
+
+// Run the deferred vblank callbacks, if there has been a vblank since they were last run
+// Call this from the main loop of one core; the callbacks run once however many vblanks have been missed
+// Returns:
+// - The number of vblanks since the last run, so 0 if nothing was run
+//
+uint run_vblank_callbacks(void) {
+    struct VblankCallback list[vblank_max_callbacks];
+    uint frame = vblank_count;
+    uint frames = frame - vblank_deferred_frame;
+
+    if(frames == 0) {
+        return 0;
+    }
+    vblank_deferred_frame = frame;
+    int count = cvideo_get_callbacks(list, true);
+    for(int i = 0; i < count; i++) {
+        list[i].callback(frame, list[i].data);
     }
-    dma_channel_set_read_addr(dma_channel_1, &bitmap[width * bline++], true);   // Line up the next block of pixels
-    hw_set_bits(&pio0->irq, 1u);										// Reset the IRQ
+    return frames;
 }
 
 // The DMA interrupt handler
-// This feeds the state machine cvideo_sync with data for the PAL(ish) video signal
+// This is raised once per field, when the sync chain hits the NULL at the end of the field in sync_line_table.
+// The FIFO still holds the last few slices of the field, so the chain is restarted first
 // 
 void cvideo_dma_handler(void) {
-	
-    // Switch condition on the vertical scanline number (vline)
-    // Each statement does a dma_channel_set_read_addr to point the PIO to the next data to output
-    //
-    switch(vline) {
-		
-        // First deal with the vertical sync scanlines
-        // Also on scanline 3, preload the first pixel buffer scanline
-        //
-        case 1 ... 2:
-            dma_channel_set_read_addr(dma_channel_0, vsync_ll, true);
-            break;
-        case 3:
-            dma_channel_set_read_addr(dma_channel_0, vsync_ls, true);
-            break;
-        case 4 ... 5:
-        case 310 ... 312:
-            dma_channel_set_read_addr(dma_channel_0, vsync_ss, true);
-            break;
+    dma_hw->ints0 = 1u << dma_channel_0;    // Clear the interrupt request
+    if(++video_field >= video_timing->fields) {
+        video_field = 0;
+    }
+    dma_channel_set_read_addr(dma_channel_2, sync_field_start[video_field], true);  // And restart the chain at the next field
 
-        // Then the border scanlines
-        //
-        case 6 ... 68:
-        case 261 ... 309:
-            dma_channel_set_read_addr(dma_channel_0, border, true);
-            break;
+    vblank_time = time_us_32();
+    vblank_count++;
 
-        // Now point the dma at the first buffer for the pixel data,
-        // and preload the data for the next scanline
-        // 
-        default:
-            dma_channel_set_read_addr(dma_channel_0, hsync, true);
-            break;
+    uint32_t status = spin_lock_blocking(display_lock);
+    if(video_field == 0) {                  // Only swap between frames, so both fields come from the same buffer
+        if(swap_pending & swap_bitmap) {    // Swap the buffers here, well away from the active scanlines
+            unsigned char * t = bitmap_front;
+            bitmap_front = bitmap;
+            bitmap = t;
+        }
+        if(swap_pending & swap_display_list) {  // Along with the display list
+            unsigned char ** t = line_table;
+            line_table = line_table_back;
+            line_table_back = t;
+        }
+        swap_pending = 0;
     }
+    spin_unlock(display_lock, status);
 
-    // Increment and wrap the counters
+    // Restart the pixel data chain; the first line is queued up in the FIFO until the state machine needs it
     //
-    if(vline++ >= 312) {    // If we've gone past the bottom scanline then
-        vline = 1;		    // Reset the scanline counter
-        vblank_count++;
+    dma_channel_set_read_addr(dma_channel_3, line_table + line_field_start[video_field], true);
+    if(data_restart) {                      // After a mode change, start the pixel state machine
+        pio_0->irq = 1u << 4;               // Clear the stale IRQ 4 raised by the scanlines it missed
+        pio_sm_clkdiv_restart(pio_0, sm_data);  // Only its own clock divider; restarting the sync's would shift the sync pulses
+        pio_sm_set_enabled(pio_0, sm_data, true);   // It waits for IRQ 4 from the sync, so picks up at the next line
+        data_restart = false;
     }
 
-    // Finally, clear the interrupt request ready for the next horizontal sync interrupt
-    //
-    dma_hw->ints0 = 1u << dma_channel_0;	
+    __sev();                                // Wake anything waiting for the vblank, on either core
+
+    struct VblankCallback list[vblank_max_callbacks];
+    int count = cvideo_get_callbacks(list, false);
+    for(int i = 0; i < count; i++) {        // Then run the callbacks
+        list[i].callback(vblank_count, list[i].data);
+    }
+}
+
+// Build the sync line table from the runs in the video timing
+// Each entry points the sync DMA at the sync table for that scanline
+//
+void cvideo_build_sync_table(void) {
+    static unsigned short * const tables[] = {  // Indexed by sync_ll to sync_active
+        vsync_ll, vsync_ss, vsync_ls, vsync_sl, vsync_sb, vsync_bs, border, hsync,
+    };
+    const struct SyncRun * r = video_timing->runs;
+    int vline = 0;
+
+    for(int f = 0; f < video_timing->fields; f++, r++) {
+        sync_field_start[f] = &sync_line_table[vline];
+        for(; r->count > 0; r++) {
+            for(int j = 0; j < r->count; j++) {
+                sync_line_table[vline++] = tables[r->type];
+            }
+        }
+        sync_line_table[vline++] = NULL;    // Terminate the chain at the end of each field
+    }
 }
 
 // Configure the PIO DMA
@@ -309,24 +1076,47 @@ void cvideo_dma_handler(void) {
 // - pio: The PIO to attach this to
 // - sm: The state machine number
 // - dma_channel: The DMA channel
+// - chain_to: The DMA channel to trigger when each transfer completes, or dma_channel for none
 // - transfer_size: Size of each DMA bus transfer (DMA_SIZE_8, DMA_SIZE_16 or DMA_SIZE_32)
-// - buffer_size_words: Number of bytes to transfer
+// - buffer_size: Number of transfers per trigger
 // - handler: Address of the interrupt handler, or NULL for no interrupts
 //
-void cvideo_configure_pio_dma(PIO pio, uint sm, uint dma_channel, uint transfer_size, size_t buffer_size, irq_handler_t handler) {
+void cvideo_configure_pio_dma(PIO pio, uint sm, uint dma_channel, uint chain_to, uint transfer_size, size_t buffer_size, irq_handler_t handler) {
+    bool chained = chain_to != dma_channel;
     dma_channel_config c = dma_channel_get_default_config(dma_channel);
     channel_config_set_transfer_data_size(&c, transfer_size);
     channel_config_set_read_increment(&c, true);
     channel_config_set_dreq(&c, pio_get_dreq(pio, sm, true));
+    channel_config_set_chain_to(&c, chain_to);
+    channel_config_set_irq_quiet(&c, chained);  // Chained channels only interrupt at the end of the chain
     dma_channel_configure(dma_channel, &c,
         &pio->txf[sm],              // Destination pointer
         NULL,                       // Source pointer
         buffer_size,                // Size of buffer
-        true                        // Start flag (true = start immediately)
+        !chained                    // Start flag (true = start immediately); chained channels are started by the chain
     );
     if(handler != NULL) {
         dma_channel_set_irq0_enabled(dma_channel, true);
         irq_set_exclusive_handler(DMA_IRQ_0, handler);
         irq_set_enabled(DMA_IRQ_0, true);
     }
-}
\ No newline at end of file
+}
+
+// Configure a control DMA channel
+// This writes a table of addresses, one per trigger, to the read address trigger of another channel
+// Parameters:
+// - dma_channel: The control DMA channel
+// - target_channel: The DMA channel to reprogram
+//
+void cvideo_configure_control_dma(uint dma_channel, uint target_channel) {
+    dma_channel_config c = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(dma_channel, &c,
+        &dma_hw->ch[target_channel].al3_read_addr_trig, // Destination pointer
+        NULL,                       // Source pointer; set when the chain is started
+        1,                          // One address per trigger
+        false                       // Don't start yet
+    );
+}
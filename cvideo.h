@@ -2,7 +2,7 @@
 // Title:	        Pico-mposite Video Output
 // Author:	        Dean Belfield
 // Created:	        26/01/2021
-// Last Updated:	26/09/2024
+// Last Updated:	17/10/2026
 //
 // Modinfo:
 // 31/01/2022:      Tweaks to reflect code changes
@@ -12,15 +12,28 @@
 // 20/02/2022:      Bitmap is now dynamically allocated
 // 01/03/2022:      Tweaked sync parameters for colour version
 // 26/09/2024:		Externed variables
+// 17/10/2026:      Added double buffering with flip
+//                  Added packed 4bpp bitmap option
+//                  Added sync line table and control DMA
+//                  Added bitmap line table; removed cvideo_pio_handler
+//                  Added cvideo_check_width
+//                  Added display lists, line doubled modes
+//                  Added hardware scrolling, bitmap_row
+//                  Added display batches
+//                  Exported vblank_count
+//                  Added video timing descriptors, with PAL and NTSC presets
+//                  Added interlaced video timings
+//                  The PIO clock dividers are now worked out from clk_sys; added set_mode_width and video_clocks
+//                  Added mode_memory_size; removed cvideo_allocate_display_lists
+//                  Added vblank_time, vblank callbacks, wait_frame and get_frame
 
 #pragma once
 
 #include "config.h"
+#include "video_memory.h"
 
-#define piofreq_0 5.25f         // Clock frequence of state machine for PIO handling sync
-#define piofreq_1_256 7.00f     // Clock frequency of state machine for PIO handling pixel data at various resolutions
-#define piofreq_1_320 5.60f
-#define piofreq_1_640 2.80f
+#define sync_cycles_line    (32 * 48)   // Cycles of the sync state machine per scanline; 48 for each of the 32 slices
+#define data_cycles_pixel   3           // Cycles of the pixel data state machine per pixel
 
 #define sm_sync 0               // State machine number in the PIO for the sync data
 #define sm_data 1               // State machine number in the PIO for the pixel data   
@@ -35,6 +48,7 @@
     #define BORD        0x8000
     #define gpio_base   0
     #define gpio_count  5
+    #define gpio_count_4bpp 4   // Pixel pins driven in 4bpp mode; the top pin is left high by the border, adding colour_base
 #else
     #define colour_base 0x00
     #define colour_max  0xFF
@@ -47,18 +61,127 @@
     #define gpio_count  10
 #endif
 
-extern unsigned char * bitmap;
+#define mode_width_mask     0x0F    // The bits of the mode number for set_mode that select the width
+#define mode_line_double    0x10    // Add to the mode number for set_mode for a half height, line doubled bitmap
+
+#define sync_ll         0       // Scanline types for the sync runs in a video timing descriptor; l is long, s is short
+#define sync_ss         1
+#define sync_ls         2
+#define sync_sl         3       // The half line patterns used between the fields of an interlaced frame
+#define sync_sb         4       // A short pulse then a blank half line
+#define sync_bs         5       // A blank half line then a short pulse
+#define sync_border     6
+#define sync_active     7       // A scanline with a gap for the pixel data
+
+#define video_max_lines 625     // The most scanlines in a frame
+#define video_max_fields 2
+#define video_max_runs  24      // The most sync runs in a frame, including the terminator for each field
+
+struct SyncRun {                // A run of scanlines with the same sync pattern
+    unsigned short count;       // The number of scanlines; 0 to end the list
+    unsigned char type;         // The sync pattern (sync_ll to sync_active)
+};
+
+struct VideoTiming {            // A video standard
+    const char * name;
+    int rate;                   // The field rate in Hz, for reference
+    int fields;                 // 1 for progressive, 2 for interlaced
+    uint32_t line_ns;           // The length of a scanline in nanoseconds
+    uint32_t active_ns;         // The length of the line of pixels in nanoseconds, whatever the width
+    struct SyncRun runs[video_max_runs];    // The scanlines of each field in turn from line 1, each with one run of
+                                            // active lines and ending with a run of 0
+};
+
+extern const struct VideoTiming video_timing_pal;               // 312 lines at 50Hz, 192 visible
+extern const struct VideoTiming video_timing_ntsc;              // 262 lines at 60Hz, 192 visible
+extern const struct VideoTiming video_timing_pal_interlaced;    // 625 lines at 50 fields a second, 384 visible
+extern const struct VideoTiming video_timing_ntsc_interlaced;   // 525 lines at 60 fields a second, 480 visible
+extern const struct VideoTiming * video_timing;                 // The timing being output
+
+struct VideoClocks {            // The PIO clock dividers, worked out from clk_sys by set_mode
+    uint32_t sys_hz;            // The system clock they were worked out for
+    uint32_t sync_clkdiv;       // The dividers as written to the PIO, in 16.8 fixed point in the top 24 bits
+    uint32_t data_clkdiv;
+    int line_error;             // The error in the line period, in parts per million
+    int pixel_error;            // The error in the pixel clock, and so in the width of the picture, in parts per million
+};
+
+extern struct VideoClocks video_clocks;
+
+#if opt_4bpp == 1
+    #if opt_colour == 1
+        #error "opt_4bpp is only supported on the monochrome board"
+    #endif
+    #define pixel_bits  4       // Bits per pixel in the bitmap; even pixels are in the low nibble of each byte
+#else
+    #define pixel_bits  8
+#endif
+
+extern unsigned char * bitmap;          // The bitmap being drawn to (the back buffer if double buffered)
+extern unsigned char * bitmap_front;    // The bitmap being scanned out
+
+extern bool double_buffered;
 
 extern int width;
 extern int height;
+extern int stride;                      // Bytes per row of the bitmap; always a multiple of 4 as it is scanned out in words
+extern int display_lines;               // Number of visible scanlines; the fields of an interlaced frame show alternate ones
+
+extern unsigned char ** display_list;   // The display list being edited; shown by commit_display_list or flip
+extern int scroll_offset;               // The bitmap row shown at the top of the screen
+extern volatile uint vblank_count;      // Incremented once a frame (once a field if interlaced)
+extern volatile uint32_t vblank_time;   // time_us_32 at the start of the last vblank
+
+#define vblank_max_callbacks    8
+
+typedef void (* vblank_callback_t)(uint frame, void * data);    // Called every vblank with vblank_count
 
 int initialise_cvideo(void);
 int set_mode(int mode);
+int set_mode_width(int w, int flags);
+int set_video_timing(const struct VideoTiming * timing);
+bool cvideo_check_width(int w);
+uint32_t cvideo_clkdiv(uint32_t ns, uint32_t cycles, int * error);
+int cvideo_check_timing(const struct VideoTiming * timing);
+int set_double_buffer(bool enabled);
+uint32_t mode_memory_size(int w, int flags, bool double_buffered);
 
-void cvideo_configure_pio_dma(PIO pio, uint sm, uint dma_channel, uint transfer_size, size_t buffer_size,  irq_handler_t handler);
+void cvideo_configure_pio_dma(PIO pio, uint sm, uint dma_channel, uint chain_to, uint transfer_size, size_t buffer_size,  irq_handler_t handler);
+void cvideo_configure_control_dma(uint dma_channel, uint target_channel);
+void cvideo_build_sync_table(void);
+bool cvideo_plan_mode(struct VideoLayout * layout, int w, int flags, const struct VideoTiming * timing);
+void cvideo_use_layout(const struct VideoLayout * layout, int length);
+void cvideo_copy_display_list(unsigned char ** table);
+void cvideo_rebase_display_list(unsigned char ** table, int count, unsigned char * from, unsigned char * to);
 
-void cvideo_pio_handler(void);
 void cvideo_dma_handler(void);
 
 void wait_vblank(void);
+uint wait_frame(uint frame);
+uint get_frame(uint32_t * time);
+int add_vblank_callback(vblank_callback_t callback, void * data, bool deferred);
+void remove_vblank_callback(vblank_callback_t callback, void * data);
+uint run_vblank_callbacks(void);
+void flip(bool wait);
+void wait_flip(void);
+
+void reset_display_list(void);
+void set_display_lines(int line, int count, unsigned char * buffer, int row, int rows, int repeat);
+void commit_display_list(bool wait);
+void begin_display_batch(void);
+void end_display_batch(void);
+void set_scroll(int offset);
 void set_border(unsigned char colour);
+
+// Get the address of a row of the bitmap, taking the hardware scroll into account
+// - y: The row on screen (0 to height - 1)
+// Returns:
+// - Pointer to the first byte of that row in the bitmap
+//
+static inline unsigned char * bitmap_row(int y) {
+    y += scroll_offset;
+    if(y >= height) {
+        y -= height;
+    }
+    return &bitmap[stride * y];
+}
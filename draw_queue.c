@@ -0,0 +1,228 @@
+//
+// Title:	        Pico-mposite Draw Queue
+// Description:		Queues graphics primitives for core 1 to draw
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Added the draw queue, with fences and a queued flip
+// 17/10/2026:      Strings are queued as one command, with a copy of the text
+// 17/10/2026:      Core 1 sleeps while the queue is empty, and core 0 while it is full or waiting for a fence
+//
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#include "cvideo.h"
+#include "graphics.h"
+#include "ring.h"
+
+#include "draw_queue.h"
+
+/*
+ * Core 0 writes fixed size commands to the queue and carries on with the next job, such as transforming
+ * the next object, while core 1 reads them and calls the graphics primitives. Fences are a count of the
+ * commands queued so far; core 1 counts the commands it has finished, so waiting for a fence is just
+ * waiting for that count to catch up. queue_flip queues a flip, so core 1 finishes the frame, flips at
+ * the next vblank and then starts on the next frame, which core 0 may already have queued.
+ *
+ * Strings are copied into the queue straight after their command, so the caller can reuse the buffer.
+ *
+ * Neither core spins; each sleeps with __wfe, and sends an event with __sev when it has changed the queue,
+ * so core 1 wakes when there is a command, and core 0 when there is room or a fence has passed.
+ *
+ * Core 0 must not draw to the bitmap directly while there are commands outstanding, and core 1 cannot
+ * run the terminal at the same time
+ */
+
+static unsigned char draw_queue_buffer[draw_queue_size];
+static struct Ring draw_queue;
+
+static uint32_t draw_queued;                // Commands queued, only changed by core 0
+static volatile uint32_t draw_done;         // Commands finished, only changed by core 1
+
+// Start core 1 drawing from the queue
+//
+void initialise_draw_queue(void) {
+    ring_init(&draw_queue, draw_queue_buffer, sizeof(draw_queue_buffer));
+    draw_queued = 0;
+    draw_done = 0;
+    multicore_reset_core1();
+    multicore_launch_core1(draw_queue_core1);
+}
+
+// Finish drawing and stop core 1
+//
+void stop_draw_queue(void) {
+    struct DrawCommand cmd = { .type = cmd_stop };
+    queue_command(&cmd);
+    queue_flush();
+    multicore_reset_core1();
+}
+
+// The draw loop on core 1
+//
+void draw_queue_core1(void) {
+    struct DrawCommand cmd;
+
+    while(true) {
+        if(ring_count(&draw_queue) < sizeof(cmd)) {
+            __wfe();                        // Sleep until core 0 queues something
+            continue;
+        }
+        ring_read(&draw_queue, &cmd, sizeof(cmd));
+        if(cmd.type == cmd_string) {        // The text was written along with the command
+            char text[draw_string_max];
+            ring_read(&draw_queue, text, cmd.p[2]);
+            for(int i = 0; i < cmd.p[2]; i++) {
+                print_char(cmd.p[0] + i * 8, cmd.p[1], text[i], cmd.p[3], cmd.c);
+            }
+        }
+        else {
+            draw_execute(&cmd);
+        }
+        __mem_fence_release();              // Make sure the pixels are written before the fence moves on
+        draw_done++;
+        __sev();                            // Wake core 0 if it is waiting for room or a fence
+        if(cmd.type == cmd_stop) {
+            return;
+        }
+    }
+}
+
+// Draw a command
+// - cmd: The command
+//
+void draw_execute(struct DrawCommand * cmd) {
+    short * p = cmd->p;
+
+    switch(cmd->type) {
+        case cmd_cls:
+            cls(cmd->c);
+            break;
+        case cmd_line:
+            draw_line(p[0], p[1], p[2], p[3], cmd->c);
+            break;
+        case cmd_triangle:
+            draw_triangle(p[0], p[1], p[2], p[3], p[4], p[5], cmd->c, cmd->filled);
+            break;
+        case cmd_polygon:
+            draw_polygon(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], cmd->c, cmd->filled);
+            break;
+        case cmd_circle:
+            draw_circle(p[0], p[1], p[2], cmd->c, cmd->filled);
+            break;
+        case cmd_char:
+            print_char(p[0], p[1], p[2], p[3], cmd->c);
+            break;
+        case cmd_blit:
+            blit(cmd->data, p[0], p[1], p[2], p[3], p[4], p[5]);
+            break;
+        case cmd_flip:
+            flip(true);
+            break;
+    }
+}
+
+// Add a command to the queue, waiting for space if it is full
+// - cmd: The command
+// Returns:
+// - The fence for this command
+//
+uint32_t queue_command(struct DrawCommand * cmd) {
+    while(!ring_write(&draw_queue, cmd, sizeof(*cmd))) {
+        __wfe();                            // Sleep until core 1 has finished a command
+    }
+    __sev();                                // Wake core 1
+    return ++draw_queued;
+}
+
+void queue_cls(unsigned char c) {
+    struct DrawCommand cmd = { .type = cmd_cls, .c = c };
+    queue_command(&cmd);
+}
+
+void queue_line(int x1, int y1, int x2, int y2, unsigned char c) {
+    struct DrawCommand cmd = { .type = cmd_line, .c = c, .p = { x1, y1, x2, y2 } };
+    queue_command(&cmd);
+}
+
+void queue_triangle(int x1, int y1, int x2, int y2, int x3, int y3, unsigned char c, bool filled) {
+    struct DrawCommand cmd = { .type = cmd_triangle, .c = c, .filled = filled, .p = { x1, y1, x2, y2, x3, y3 } };
+    queue_command(&cmd);
+}
+
+void queue_polygon(int x1, int y1, int x2, int y2, int x3, int y3, int x4, int y4, unsigned char c, bool filled) {
+    struct DrawCommand cmd = { .type = cmd_polygon, .c = c, .filled = filled, .p = { x1, y1, x2, y2, x3, y3, x4, y4 } };
+    queue_command(&cmd);
+}
+
+void queue_circle(int x, int y, int r, unsigned char c, bool filled) {
+    struct DrawCommand cmd = { .type = cmd_circle, .c = c, .filled = filled, .p = { x, y, r } };
+    queue_command(&cmd);
+}
+
+// Queue a string
+// The text is copied into the queue, up to draw_string_max characters to a command
+//
+void queue_print_string(int x, int y, char * s, unsigned char bc, unsigned char fc) {
+    int n = strlen(s);
+
+    for(int i = 0; i < n; i += draw_string_max) {
+        unsigned char buffer[sizeof(struct DrawCommand) + draw_string_max];
+        int length = n - i < draw_string_max ? n - i : draw_string_max;
+        struct DrawCommand cmd = { .type = cmd_string, .c = fc, .p = { x + i * 8, y, length, bc } };
+        memcpy(buffer, &cmd, sizeof(cmd));
+        memcpy(buffer + sizeof(cmd), s + i, length);
+        while(!ring_write(&draw_queue, buffer, sizeof(cmd) + length)) {    // Written in one go, so core 1 sees all of it
+            __wfe();
+        }
+        __sev();
+        ++draw_queued;
+    }
+}
+
+// Queue a blit
+// The source data is not copied, so must not change until the blit has been drawn
+//
+void queue_blit(const void * data, int sx, int sy, int sw, int sh, int dx, int dy) {
+    struct DrawCommand cmd = { .type = cmd_blit, .data = data, .p = { sx, sy, sw, sh, dx, dy } };
+    queue_command(&cmd);
+}
+
+// Queue a flip
+// Core 1 flips once it has drawn everything queued before this, at the next vblank
+// Returns:
+// - The fence for the flip; once this has passed the frame is on screen
+//
+uint32_t queue_flip(void) {
+    struct DrawCommand cmd = { .type = cmd_flip };
+    return queue_command(&cmd);
+}
+
+// Get a fence for everything queued so far
+//
+uint32_t queue_fence(void) {
+    return draw_queued;
+}
+
+// Wait for core 1 to finish drawing up to a fence
+// - fence: The fence
+//
+void queue_wait(uint32_t fence) {
+    while((int32_t)(draw_done - fence) < 0) {
+        __wfe();                            // Sleep until core 1 has finished a command
+    }
+    __mem_fence_acquire();
+}
+
+// Wait for core 1 to finish drawing everything queued
+//
+void queue_flush(void) {
+    queue_wait(draw_queued);
+}
@@ -0,0 +1,55 @@
+//
+// Title:	        Pico-mposite Draw Queue
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Added the draw queue, with fences and a queued flip
+// 17/10/2026:      Strings are queued as one command, with a copy of the text; added cmd_string
+//
+
+#pragma once
+
+#include <stdbool.h>
+
+#define draw_queue_size     4096    // Size of the command queue in bytes; must be a power of two
+#define draw_string_max     64      // Longest string sent in one command; longer strings are split
+
+#define cmd_stop            0       // Command types
+#define cmd_cls             1
+#define cmd_line            2
+#define cmd_triangle        3
+#define cmd_polygon         4
+#define cmd_circle          5
+#define cmd_char            6
+#define cmd_blit            7
+#define cmd_flip            8
+#define cmd_string          9       // Followed in the queue by p[2] characters of text
+
+struct DrawCommand {
+    unsigned char type;
+    unsigned char c;                // Colour
+    bool filled;
+    const void * data;              // Source data for blit
+    short p[8];                     // Coordinates and other parameters
+};
+
+void initialise_draw_queue(void);
+void stop_draw_queue(void);
+void draw_queue_core1(void);
+void draw_execute(struct DrawCommand * cmd);
+uint32_t queue_command(struct DrawCommand * cmd);
+
+void queue_cls(unsigned char c);
+void queue_line(int x1, int y1, int x2, int y2, unsigned char c);
+void queue_triangle(int x1, int y1, int x2, int y2, int x3, int y3, unsigned char c, bool filled);
+void queue_polygon(int x1, int y1, int x2, int y2, int x3, int y3, int x4, int y4, unsigned char c, bool filled);
+void queue_circle(int x, int y, int r, unsigned char c, bool filled);
+void queue_print_string(int x, int y, char * s, unsigned char bc, unsigned char fc);
+void queue_blit(const void * data, int sx, int sy, int sw, int sh, int dx, int dy);
+
+uint32_t queue_flip(void);
+uint32_t queue_fence(void);
+void queue_wait(uint32_t fence);
+void queue_flush(void);
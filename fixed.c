@@ -0,0 +1,211 @@
+//
+// Title:	        Pico-mposite Fixed Point Maths
+// Description:		Fixed point trig, matrices and 3D transforms
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+
+#include "fixed.h"
+
+/*
+ * The RP2040 has no FPU, so the doubles that the 3D demos used were done in software at a few hundred cycles
+ * for each sin, cos, multiply and divide. Here everything is 16.16 fixed point in integer registers: sin and cos
+ * come from a quarter wave table, a matrix is built once per object, and the vertices are then transformed and
+ * projected in batches with one divide per vertex
+ */
+
+// sin(i * pi / 512) for a quarter turn, in 16.16
+//
+static const fixed sine_table[257] = {
+         0,    402,    804,   1206,   1608,   2010,   2412,   2814,
+      3216,   3617,   4019,   4420,   4821,   5222,   5623,   6023,
+      6424,   6824,   7224,   7623,   8022,   8421,   8820,   9218,
+      9616,  10014,  10411,  10808,  11204,  11600,  11996,  12391,
+     12785,  13180,  13573,  13966,  14359,  14751,  15143,  15534,
+     15924,  16314,  16703,  17091,  17479,  17867,  18253,  18639,
+     19024,  19409,  19792,  20175,  20557,  20939,  21320,  21699,
+     22078,  22457,  22834,  23210,  23586,  23961,  24335,  24708,
+     25080,  25451,  25821,  26190,  26558,  26925,  27291,  27656,
+     28020,  28383,  28745,  29106,  29466,  29824,  30182,  30538,
+     30893,  31248,  31600,  31952,  32303,  32652,  33000,  33347,
+     33692,  34037,  34380,  34721,  35062,  35401,  35738,  36075,
+     36410,  36744,  37076,  37407,  37736,  38064,  38391,  38716,
+     39040,  39362,  39683,  40002,  40320,  40636,  40951,  41264,
+     41576,  41886,  42194,  42501,  42806,  43110,  43412,  43713,
+     44011,  44308,  44604,  44898,  45190,  45480,  45769,  46056,
+     46341,  46624,  46906,  47186,  47464,  47741,  48015,  48288,
+     48559,  48828,  49095,  49361,  49624,  49886,  50146,  50404,
+     50660,  50914,  51166,  51417,  51665,  51911,  52156,  52398,
+     52639,  52878,  53114,  53349,  53581,  53812,  54040,  54267,
+     54491,  54714,  54934,  55152,  55368,  55582,  55794,  56004,
+     56212,  56418,  56621,  56823,  57022,  57219,  57414,  57607,
+     57798,  57986,  58172,  58356,  58538,  58718,  58896,  59071,
+     59244,  59415,  59583,  59750,  59914,  60075,  60235,  60392,
+     60547,  60700,  60851,  60999,  61145,  61288,  61429,  61568,
+     61705,  61839,  61971,  62101,  62228,  62353,  62476,  62596,
+     62714,  62830,  62943,  63054,  63162,  63268,  63372,  63473,
+     63572,  63668,  63763,  63854,  63944,  64031,  64115,  64197,
+     64277,  64354,  64429,  64501,  64571,  64639,  64704,  64766,
+     64827,  64884,  64940,  64993,  65043,  65091,  65137,  65180,
+     65220,  65259,  65294,  65328,  65358,  65387,  65413,  65436,
+     65457,  65476,  65492,  65505,  65516,  65525,  65531,  65535,
+     65536,
+};
+
+// Get the sine of an angle
+// The table is interpolated between entries
+// - a: The angle, in 65536ths of a turn
+// Returns:
+// - The sine in 16.16
+//
+fixed fixed_sin(uint16_t a) {
+    int p = a & (angle_quarter - 1);        // The position in the quarter turn
+    if(a & angle_quarter) {                 // Second and fourth quarters run backwards through the table
+        p = angle_quarter - p;
+    }
+    int i = p >> 6;
+    fixed s = sine_table[i];
+    if(i < 256) {
+        s += ((sine_table[i + 1] - s) * (p & 63)) >> 6;
+    }
+    return a & (angle_quarter * 2) ? -s : s;
+}
+
+// Get the cosine of an angle
+// - a: The angle, in 65536ths of a turn
+// Returns:
+// - The cosine in 16.16
+//
+fixed fixed_cos(uint16_t a) {
+    return fixed_sin(a + angle_quarter);
+}
+
+void matrix3_identity(struct Matrix3 * m) {
+    for(int i = 0; i < 3; i++) {
+        for(int j = 0; j < 3; j++) {
+            m->m[i][j] = i == j ? fixed_one : 0;
+        }
+    }
+}
+
+// Build a rotation matrix
+// The rotation is about the x axis first, then y, then z
+// - m: The matrix
+// - ax, ay, az: The angles about each axis
+//
+void matrix3_rotate(struct Matrix3 * m, uint16_t ax, uint16_t ay, uint16_t az) {
+    fixed sx = fixed_sin(ax), cx = fixed_cos(ax);
+    fixed sy = fixed_sin(ay), cy = fixed_cos(ay);
+    fixed sz = fixed_sin(az), cz = fixed_cos(az);
+    struct Matrix3 rx = {{ { fixed_one, 0, 0 }, { 0, cx, -sx }, { 0, sx, cx } }};
+    struct Matrix3 ry = {{ { cy, 0, sy }, { 0, fixed_one, 0 }, { -sy, 0, cy } }};
+    struct Matrix3 rz = {{ { cz, -sz, 0 }, { sz, cz, 0 }, { 0, 0, fixed_one } }};
+    struct Matrix3 t;
+
+    matrix3_multiply(&t, &ry, &rx);
+    matrix3_multiply(m, &rz, &t);
+}
+
+// Multiply two matrices, so r = a * b
+// r must not be a or b
+//
+void matrix3_multiply(struct Matrix3 * r, const struct Matrix3 * a, const struct Matrix3 * b) {
+    for(int i = 0; i < 3; i++) {
+        for(int j = 0; j < 3; j++) {
+            int64_t s = 0;
+            for(int k = 0; k < 3; k++) {
+                s += (int64_t)a->m[i][k] * b->m[k][j];
+            }
+            r->m[i][j] = (fixed)(s >> 16);
+        }
+    }
+}
+
+void matrix4_identity(struct Matrix4 * m) {
+    for(int i = 0; i < 4; i++) {
+        for(int j = 0; j < 4; j++) {
+            m->m[i][j] = i == j ? fixed_one : 0;
+        }
+    }
+}
+
+// Build a matrix from a rotation and a translation
+// - m: The matrix
+// - r: The rotation
+// - t: The translation, applied after the rotation
+//
+void matrix4_set(struct Matrix4 * m, const struct Matrix3 * r, const struct Vector * t) {
+    for(int i = 0; i < 3; i++) {
+        for(int j = 0; j < 3; j++) {
+            m->m[i][j] = r->m[i][j];
+        }
+        m->m[3][i] = 0;
+    }
+    m->m[0][3] = t->x;
+    m->m[1][3] = t->y;
+    m->m[2][3] = t->z;
+    m->m[3][3] = fixed_one;
+}
+
+// Multiply two matrices, so r = a * b
+// r must not be a or b
+//
+void matrix4_multiply(struct Matrix4 * r, const struct Matrix4 * a, const struct Matrix4 * b) {
+    for(int i = 0; i < 4; i++) {
+        for(int j = 0; j < 4; j++) {
+            int64_t s = 0;
+            for(int k = 0; k < 4; k++) {
+                s += (int64_t)a->m[i][k] * b->m[k][j];
+            }
+            r->m[i][j] = (fixed)(s >> 16);
+        }
+    }
+}
+
+// Transform a list of vertices
+// - m: The matrix; the bottom row is taken to be 0, 0, 0, 1
+// - in: The vertices
+// - out: The transformed vertices; can be the same as in
+// - count: Number of vertices
+//
+void transform_vertices(const struct Matrix4 * m, const struct Vector * in, struct Vector * out, int count) {
+    for(int i = 0; i < count; i++) {
+        int64_t x = in[i].x, y = in[i].y, z = in[i].z;
+        out[i].x = (fixed)((m->m[0][0] * x + m->m[0][1] * y + m->m[0][2] * z) >> 16) + m->m[0][3];
+        out[i].y = (fixed)((m->m[1][0] * x + m->m[1][1] * y + m->m[1][2] * z) >> 16) + m->m[1][3];
+        out[i].z = (fixed)((m->m[2][0] * x + m->m[2][1] * y + m->m[2][2] * z) >> 16) + m->m[2][3];
+    }
+}
+
+// Project a list of vertices onto the screen
+// Vertices closer than one unit from the viewer are projected as if they were at that distance
+// - p: The projection
+// - in: The vertices
+// - out: The points on screen, in 16.16
+// - count: Number of vertices
+//
+void project_vertices(const struct Projection * p, const struct Vector * in, struct Point * out, int count) {
+    for(int i = 0; i < count; i++) {
+        fixed depth = p->distance - in[i].z;
+        if(depth < fixed_one) {
+            depth = fixed_one;
+        }
+        fixed k = fixed_div(p->scale, depth);
+        out[i].x = p->cx + fixed_mul(in[i].x, k);
+        out[i].y = p->cy + fixed_mul(in[i].y, k);
+    }
+}
+
+// Check whether a face is facing the viewer
+// Faces are facing the viewer if their corners go anticlockwise on screen
+// - a, b, c: The first three corners of the face on screen
+// Returns:
+// - true if the face is facing the viewer, or is edge on
+//
+bool face_visible(const struct Point * a, const struct Point * b, const struct Point * c) {
+    int64_t area = ((int64_t)b->x - a->x) * ((int64_t)c->y - a->y) - ((int64_t)c->x - a->x) * ((int64_t)b->y - a->y);
+    return area <= 0;
+}
@@ -0,0 +1,72 @@
+//
+// Title:	        Pico-mposite Fixed Point Maths
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int32_t fixed;              // A 16.16 fixed point number
+
+#define fixed_one           65536
+#define int_to_fixed(i)     ((fixed)((i) * fixed_one))
+#define fixed_to_int(f)     ((f) >> 16)                 // Rounds down
+#define float_to_fixed(f)   ((fixed)((f) * fixed_one))  // For constants; the Pico has no FPU
+
+#define angle_full          65536   // Angles are in 65536ths of a turn, so wrap around in a uint16_t
+#define angle_quarter       16384
+
+struct Vector {                     // A point in 3D
+    fixed x, y, z;
+};
+
+struct Point {                      // A point on screen
+    fixed x, y;
+};
+
+struct Matrix3 {                    // A rotation
+    fixed m[3][3];
+};
+
+struct Matrix4 {                    // A rotation and translation; the bottom row is always 0, 0, 0, 1
+    fixed m[4][4];
+};
+
+struct Projection {                 // A perspective projection
+    fixed cx, cy;                   // The centre of the view on screen
+    fixed scale;                    // The screen distance
+    fixed distance;                 // The distance from the viewer to z = 0; z increases towards the viewer
+};
+
+// Multiply two fixed point numbers
+//
+static inline fixed fixed_mul(fixed a, fixed b) {
+    return (fixed)(((int64_t)a * b) >> 16);
+}
+
+// Divide two fixed point numbers
+//
+static inline fixed fixed_div(fixed a, fixed b) {
+    return (fixed)(((int64_t)a * fixed_one) / b);
+}
+
+fixed fixed_sin(uint16_t a);
+fixed fixed_cos(uint16_t a);
+
+void matrix3_identity(struct Matrix3 * m);
+void matrix3_rotate(struct Matrix3 * m, uint16_t ax, uint16_t ay, uint16_t az);
+void matrix3_multiply(struct Matrix3 * r, const struct Matrix3 * a, const struct Matrix3 * b);
+
+void matrix4_identity(struct Matrix4 * m);
+void matrix4_set(struct Matrix4 * m, const struct Matrix3 * r, const struct Vector * t);
+void matrix4_multiply(struct Matrix4 * r, const struct Matrix4 * a, const struct Matrix4 * b);
+
+void transform_vertices(const struct Matrix4 * m, const struct Vector * in, struct Vector * out, int count);
+void project_vertices(const struct Projection * p, const struct Vector * in, struct Point * out, int count);
+bool face_visible(const struct Point * a, const struct Point * b, const struct Point * c);
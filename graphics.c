@@ -3,7 +3,7 @@
 // Description:		A hacked-together composite video output for the Raspberry Pi Pico
 // Author:	        Dean Belfield
 // Created:	        01/02/2021
-// Last Updated:	02/03/2022
+// Last Updated:	17/10/2026
 //
 // Modinfo:
 // 03/02/2022:      Fixed bug in print_char, typos in comments
@@ -12,8 +12,16 @@
 // 08/07/2022:      Optimised filled circle drawing
 // 20/02/2022:      Added scroll_up, bitmap now initialised in cvideo.c
 // 02/03/2022:      Added blit
+// 17/10/2026:      Added 4bpp variants of the primitives, fixed off-by-one in draw_horizontal_line clipping
+// 17/10/2026:      scroll_up now uses the hardware scroll; primitives address rows through bitmap_row
+// 17/10/2026:      Filled triangles are now drawn in 16.16 fixed point with a top-left fill rule and clipping
+// 17/10/2026:      Lines are now clipped up front and drawn as runs; fixed plotting an uninitialised point for zero length lines
+// 17/10/2026:      Text is now drawn a word at a time from glyph lookup tables; added transparent text
+// 17/10/2026:      Added initialise_graphics; the glyph table is built once and text can be drawn from either core
+// 17/10/2026:      4bpp colours are masked to a nibble before packing
 
 #include <math.h>
+#include <stdlib.h>
 
 #include "memory.h"
 
@@ -26,20 +34,125 @@
 
 #include "graphics.h"
 
+// Divide, rounding towards minus infinity
+// - n: Numerator
+// - d: Denominator; must be greater than 0
+//
+static inline int64_t floor_div(int64_t n, int64_t d) {
+    int64_t q = n / d;
+    return q * d > n ? q - 1 : q;
+}
+
+// Write a pixel to a row of the bitmap
+// - row: The row, from bitmap_row
+// - x: X position on screen; must be on screen
+// - c: Pixel colour
+//
+static inline void plot_row(unsigned char * row, int x, unsigned char c) {
+    #if opt_4bpp == 1
+    c &= 0x0F;                          // Anything above colour_max would spill into the next pixel
+    unsigned char * ptr = &row[x >> 1];
+    *ptr = x & 1 ? (*ptr & 0x0F) | (c << 4) : (*ptr & 0xF0) | c;
+    #else
+    row[x] = colour_base + c;
+    #endif
+}
+
+// Fill a run of pixels in a row of the bitmap
+// - row: The row, from bitmap_row
+// - x1, x2: First and last pixel; must be on screen with x1 <= x2
+// - c: Pixel colour
+//
+static inline void fill_span(unsigned char * row, int x1, int x2, unsigned char c) {
+    #if opt_4bpp == 1
+    c &= 0x0F;
+    if(x1 & 1) {                        // Odd start pixel is in the high nibble
+        row[x1 >> 1] = (row[x1 >> 1] & 0x0F) | (c << 4);
+        x1++;
+    }
+    if(!(x2 & 1)) {                     // Even end pixel is in the low nibble
+        row[x2 >> 1] = (row[x2 >> 1] & 0xF0) | c;
+        x2--;
+    }
+    if(x1 < x2) {                       // And what's left is whole bytes
+        memset(&row[x1 >> 1], c * 0x11, (x2 - x1 + 1) >> 1);
+    }
+    #else
+    memset(row + x1, colour_base + c, x2 - x1 + 1);
+    #endif
+}
+
 // Clear the screen
 // - c: Background colour to fill screen with
 //
 void cls(unsigned char c) {
+    #if opt_4bpp == 1
+    memset(bitmap, (c & 0x0F) * 0x11, height * stride);
+    #else
     memset(bitmap, colour_base + c, height * width);
+    #endif
 }
 
 // Scroll the screen up
+// This moves the hardware scroll on rather than moving the bitmap, so only the new rows are written
 // - c: Background colour to fill blank area with
 // - rows: Number of pixel rows to scroll up by
 //
 void scroll_up(unsigned char c, int rows) {
-    memcpy(bitmap, &bitmap[width * rows], (height - rows) * width);
-    memset(&bitmap[width * (height - rows)], colour_base + c, rows * width);
+    set_scroll(scroll_offset + rows);
+    for(int i = height - rows; i < height; i++) {
+        #if opt_4bpp == 1
+        memset(bitmap_row(i), (c & 0x0F) * 0x11, stride);
+        #else
+        memset(bitmap_row(i), colour_base + c, width);
+        #endif
+    }
+}
+
+/*
+ * Text is drawn a row of a glyph at a time. Each byte of glyph data is looked up in a table of the eight
+ * pixels it expands to, as a mask of the foreground pixels, and the colours are merged in with that mask, so
+ * the row is written with two word stores (one in 4bpp mode). Transparent text merges the foreground colour
+ * into the pixels already there instead.
+ *
+ * The table does not depend on the colours, so it is built once by initialise_graphics and only read after
+ * that, and text can be drawn from both cores at once
+ */
+
+#define glyph_words (pixel_bits / 4)                // Words in an expanded row of a glyph
+
+static uint32_t glyph_mask[256][glyph_words];       // Glyph rows expanded to a mask of the foreground pixels
+
+// Initialise the graphics primitives
+// Call this before anything is drawn, and before core 1 is started
+//
+void initialise_graphics(void) {
+    uint32_t half[16];                              // Four pixels for each nibble
+
+    for(int n = 0; n < 16; n++) {
+        half[n] = 0;
+        for(int i = 0; i < 4; i++) {                // The leftmost pixel is the top bit, and the lowest address
+            half[n] |= (n & 8 >> i ? (1u << pixel_bits) - 1 : 0) << (i * pixel_bits);
+        }
+    }
+    for(int b = 0; b < 256; b++) {
+        #if opt_4bpp == 1
+        glyph_mask[b][0] = half[b >> 4] | half[b & 15] << 16;
+        #else
+        glyph_mask[b][0] = half[b >> 4];
+        glyph_mask[b][1] = half[b & 15];
+        #endif
+    }
+}
+
+// Get the pixel value to write for a colour
+//
+static inline uint32_t glyph_pixel(unsigned char c) {
+    #if opt_4bpp == 1
+    return c & 0x0F;
+    #else
+    return colour_base + c;
+    #endif
 }
 
 // Print a character
@@ -50,18 +163,92 @@ void scroll_up(unsigned char c, int rows) {
 // - fc: Foreground colour 
 //
 void print_char(int x, int y, int c, unsigned char bc, unsigned char fc) {
-    int char_index;
-    unsigned char * ptr;
+    if(c < 32 || c >= 128) {
+        return;
+    }
+    const unsigned char * data = &charset[(c - 32) * 8];
 
-    if(c >= 32 && c < 128) {
-        char_index = (c - 32) * 8;
-        ptr = &bitmap[width * y + x + 7];
+    #if opt_4bpp == 1
+    if(x & 1) {                                     // Not byte aligned, so write each nibble
         for(int row = 0; row < 8; row++) {
-            unsigned char data = charset[char_index + row];
-            for(int bit = 0; bit < 8; bit ++) {
-                *(ptr- bit) = data & 1 << bit ? colour_base + fc : colour_base + bc;
+            for(int bit = 0; bit < 8; bit++) {
+                plot(x + bit, y + row, data[row] & 0x80 >> bit ? fc : bc);
             }
-            ptr += width;
+        }
+        return;
+    }
+    #endif
+    #if opt_4bpp == 1
+    uint32_t background = glyph_pixel(bc) * 0x11111111;
+    uint32_t foreground = glyph_pixel(fc) * 0x11111111;
+    #else
+    uint32_t background = glyph_pixel(bc) * 0x01010101;
+    uint32_t foreground = glyph_pixel(fc) * 0x01010101;
+    #endif
+    for(int row = 0; row < 8; row++) {
+        unsigned char * ptr = bitmap_row(y + row) + x * pixel_bits / 8;
+        const uint32_t * mask = glyph_mask[data[row]];
+        uint32_t pixels[glyph_words];
+        for(int i = 0; i < glyph_words; i++) {
+            pixels[i] = (background & ~mask[i]) | (foreground & mask[i]);
+        }
+        if(((uintptr_t)ptr & 3) == 0) {             // Write aligned words where possible
+            ((uint32_t *)ptr)[0] = pixels[0];
+            #if opt_4bpp == 0
+            ((uint32_t *)ptr)[1] = pixels[1];
+            #endif
+        }
+        else {
+            memcpy(ptr, pixels, glyph_words * 4);
+        }
+    }
+}
+
+// Print a character without drawing the background
+// - x: X position on screen (pixels)
+// - y: Y position on screen (pixels)
+// - c: Character to print (ASCII 32 to 127)
+// - fc: Foreground colour 
+//
+void print_char_transparent(int x, int y, int c, unsigned char fc) {
+    if(c < 32 || c >= 128) {
+        return;
+    }
+    const unsigned char * data = &charset[(c - 32) * 8];
+
+    #if opt_4bpp == 1
+    if(x & 1) {
+        for(int row = 0; row < 8; row++) {
+            for(int bit = 0; bit < 8; bit++) {
+                if(data[row] & 0x80 >> bit) {
+                    plot(x + bit, y + row, fc);
+                }
+            }
+        }
+        return;
+    }
+    uint32_t colour = glyph_pixel(fc) * 0x11111111;
+    #else
+    uint32_t colour = glyph_pixel(fc) * 0x01010101;
+    #endif
+    for(int row = 0; row < 8; row++) {
+        if(data[row] == 0) {
+            continue;
+        }
+        unsigned char * ptr = bitmap_row(y + row) + x * pixel_bits / 8;
+        const uint32_t * mask = glyph_mask[data[row]];
+        if(((uintptr_t)ptr & 3) == 0) {
+            for(int i = 0; i < glyph_words; i++) {
+                ((uint32_t *)ptr)[i] = (((uint32_t *)ptr)[i] & ~mask[i]) | (colour & mask[i]);
+            }
+        }
+        else {
+            uint32_t pixels[glyph_words];
+            memcpy(pixels, ptr, glyph_words * 4);
+            for(int i = 0; i < glyph_words; i++) {
+                pixels[i] = (pixels[i] & ~mask[i]) | (colour & mask[i]);
+            }
+            memcpy(ptr, pixels, glyph_words * 4);
         }
     }
 }
@@ -70,15 +257,27 @@ void print_char(int x, int y, int c, unsigned char bc, unsigned char fc) {
 // - x: X position on screen (pixels)
 // - y: Y position on screen (pixels)
 // - s: Zero terminated string
-// - bc: Background 
-// - fc: Foreground colour (
+// - bc: Background colour 
+// - fc: Foreground colour 
 //
 void print_string(int x, int y, char *s, unsigned char bc, unsigned char fc) {
-    for(int i = 0; i < strlen(s); i++) {
+    for(int i = 0; s[i]; i++) {
         print_char(x + i * 8, y, s[i], bc, fc);
     }
 }
 
+// Print a string without drawing the background
+// - x: X position on screen (pixels)
+// - y: Y position on screen (pixels)
+// - s: Zero terminated string
+// - fc: Foreground colour 
+//
+void print_string_transparent(int x, int y, char *s, unsigned char fc) {
+    for(int i = 0; s[i]; i++) {
+        print_char_transparent(x + i * 8, y, s[i], fc);
+    }
+}
+
 // Plot a point
 // - x: X position on screen
 // - y: Y position on screen
@@ -86,68 +285,134 @@ void print_string(int x, int y, char *s, unsigned char bc, unsigned char fc) {
 //
 void plot(int x, int y, unsigned char c) {
     if(x >= 0 && x < width && y >= 0 && y < height) {
-        bitmap[width * y + x] = colour_base + c;
+        plot_row(bitmap_row(y), x, c);
     }
 }
 
-// Draw a line
-// - x1, y1: Coordinates of start point
-// - x2, y2: Coordinates of last point
-// - c: Pixel colour
+/*
+ * Lines are clipped before they are drawn, by working out the range of steps along the line that are on
+ * screen, so nothing needs checking per pixel. Pixel i along a line that is longer than it is tall is at
+ * x1 + i, y1 + round(i * dy / dx), so the first step that reaches a given row can be found by division and
+ * the clipped line starts exactly where the unclipped line would. Such a line is a run of pixels on each
+ * row, and each run is filled with fill_span; a line that is taller than it is long has one pixel per row,
+ * and is drawn by stepping a pointer down the bitmap
+ */
+
+// Get the first step along a line whose minor coordinate has reached j
+// - j: Minor coordinate, relative to the start of the line
+// - d_major, d_minor: Length of the line along each axis; d_minor must be greater than 0
 //
+static inline int line_step(int j, int d_major, int d_minor) {
+    return -floor_div((int64_t)d_major - 2 * (int64_t)d_major * j, 2 * (int64_t)d_minor);
+}
+
+// Clip the steps along a line to the screen
+// - i1, i2: First and last step; updated with the steps that are on screen
+// - v, d_major, d_minor: Minor coordinate of the start of the line and the length of the line along each axis
+// - s: Direction of the minor coordinate (-1 or 1)
+// - size: Width or height of the screen along the minor axis
+// Returns:
+// - false if the line is off the screen
+//
+static bool clip_line_steps(int * i1, int * i2, int v, int d_major, int d_minor, int s, int size) {
+    int jmin = s > 0 ? -v : v - size + 1;   // The range of minor steps that are on screen
+    int jmax = s > 0 ? size - 1 - v : v;
+    if(jmin < 0) {
+        jmin = 0;
+    }
+    if(jmax > d_minor) {
+        jmax = d_minor;
+    }
+    if(jmin > jmax) {
+        return false;
+    }
+    if(d_minor > 0) {
+        int a = line_step(jmin, d_major, d_minor);
+        int b = line_step(jmax + 1, d_major, d_minor) - 1;
+        if(a > *i1) {
+            *i1 = a;
+        }
+        if(b < *i2) {
+            *i2 = b;
+        }
+    }
+    return *i1 <= *i2;
+}
+
 // Draw a line
 // - x1, y1: Coordinates of start point
 // - x2, y2: Coordinates of last point
 // - c: Pixel colour
 //
 void draw_line(int x1, int y1, int x2, int y2, unsigned char c) {
-    int dx, dy, sx, sy, e, xp, yp, i;
-    
-    dx = x2 - x1;                   // Horizontal length
-    dy = y2 - y1;                   // Vertical length
-
-    sx = (dx > 0) - (dx < 0);       // Sign DX
-    sy = (dy > 0) - (dy < 0);       // Sign DY
+    int dx = abs(x2 - x1);
+    int dy = abs(y2 - y1);
+    int i1, i2;
 
-    dx *= sx;                       // Abs DX
-    dy *= sy;                       // Abs DY
-
-    if(dx == 0 && dy == 0) {        // For zero length lines
-        plot(xp, yp, c);            // Just plot a point
-        return;
-    }
-
-    xp = x1;                        // Start pixel coordinates
-    yp = y1;
-
-    if(dx > dy) {                   // If the line is longer than taller...
-        e = dx >> 1;
-        dy -= dx;
-        for(i = 0; i < dx; i++) {
-            plot(xp, yp, c);
-            e += dy;
-            if(e > 0) {
-                yp += sy;
-            }
-            else {
-                e += dx;
+    if(dx >= dy) {                          // If the line is longer than taller...
+        if(x1 > x2) {                       // Always draw it left to right
+            swap(&x1, &x2);
+            swap(&y1, &y2);
+        }
+        int sy = y2 >= y1 ? 1 : -1;
+        i1 = x1 < 0 ? -x1 : 0;              // Clip the steps to the left and right of the screen
+        i2 = x2 >= width ? width - 1 - x1 : dx;
+        if(i1 > i2 || !clip_line_steps(&i1, &i2, y1, dx, dy, sy, height)) {
+            return;
+        }
+        if(dy == 0) {                       // Horizontal lines are just one run
+            fill_span(bitmap_row(y1), x1 + i1, x1 + i2, c);
+            return;
+        }
+        int d = 2 * dy;                     // Step through the runs, finding the end of each
+        int j = floor_div((int64_t)2 * i1 * dy + dx, 2 * dx);
+        int64_t n = 2 * (int64_t)dx * (j + 1) - dx + d - 1;
+        int q = floor_div(n, d);            // The first step of the next run
+        int r = n - (int64_t)q * d;
+        int dq = 2 * dx / d;
+        int dr = 2 * dx % d;
+        int y = y1 + sy * j;
+        while(i1 <= i2) {
+            int end = q - 1 < i2 ? q - 1 : i2;
+            fill_span(bitmap_row(y), x1 + i1, x1 + end, c);
+            i1 = end + 1;
+            y += sy;
+            q += dq;
+            r += dr;
+            if(r >= d) {
+                q++;
+                r -= d;
             }
-            xp += sx;
         }
     }
-    else {                          // If the line is taller than longer...
-        e = dy >> 1;
-        dx -= dy;
-        for(i = 0; i < dy; i++) {
-            plot(xp, yp, c);
-            e += dx;
-            if(e > 0) {
-                xp += sx;
+    else {                                  // If the line is taller than longer...
+        if(y1 > y2) {                       // Always draw it top to bottom
+            swap(&x1, &x2);
+            swap(&y1, &y2);
+        }
+        int sx = x2 >= x1 ? 1 : -1;
+        i1 = y1 < 0 ? -y1 : 0;              // Clip the steps to the top and bottom of the screen
+        i2 = y2 >= height ? height - 1 - y1 : dy;
+        if(i1 > i2 || !clip_line_steps(&i1, &i2, x1, dy, dx, sx, width)) {
+            return;
+        }
+        int d = 2 * dy;                     // Then step down the rows, with the error term for x
+        int k = floor_div((int64_t)2 * i1 * dx + dy, d);
+        int e = (int64_t)2 * i1 * dx + dy - (int64_t)k * d;
+        int x = x1 + sx * k;
+        unsigned char * row = bitmap_row(y1 + i1);
+        unsigned char * end = bitmap + stride * height;
+        for(; i1 <= i2; i1++) {
+            plot_row(row, x, c);
+            row += stride;
+            if(row == end) {                // Wrap around with the hardware scroll
+                row = bitmap;
             }
-            else {
-                e += dy;
+            e += 2 * dx;
+            if(e >= d) {
+                e -= d;
+                x += sx;
             }
-            yp += sy;
         }
     }
 }
@@ -225,54 +490,132 @@ void draw_triangle(int x1, int y1, int x2, int y2, int x3, int y3, unsigned char
         draw_line(x3, y3, x1, y1, c);
         return;
     }
+    draw_triangle_fixed(x1 << 16, y1 << 16, x2 << 16, y2 << 16, x3 << 16, y3 << 16, c);
+}
 
-    struct Line line1;
-    struct Line line2;
-    
-    int i;
+/*
+ * The filled triangle is drawn a span at a time, stepping the x coordinate of each edge down the scanlines in
+ * 16.16 fixed point. The remainder of each step is carried as well, so an edge lands on exactly the same x on
+ * a given row whichever triangle it belongs to and whichever row it was started on.
+ *
+ * Each pixel is sampled at its centre, and a pixel on an edge is only drawn if that is a top or left edge, so
+ * triangles that share an edge (such as the two halves of a filled polygon) do not both draw it. Rows above
+ * and below the screen are skipped by starting the edges at the first visible row, and spans are clipped to
+ * the screen by draw_horizontal_line, so any part of a triangle can be off-screen
+ */
 
-    //
-    // First sort the points by Y ascending
-    // 
-    if(y1 > y3) {       // a
-        swap(&x1, &x3);
-        swap(&y1, &y3);
+// Start an edge at the centre of a pixel row
+// - edge: The edge
+// - x1, y1: Top of the edge (16.16)
+// - x2, y2: Bottom of the edge (16.16); y2 must be greater than y1
+// - row: The pixel row
+//
+static void init_edge(struct Edge * edge, int32_t x1, int32_t y1, int32_t x2, int32_t y2, int row) {
+    int32_t dx = x2 - x1;
+    int32_t dy = y2 - y1;
+    int64_t n = ((((int64_t)row << 16) + 0x8000) - y1) * dx;
+    int64_t q = floor_div(n, dy);
+    int64_t s = floor_div((int64_t)dx << 16, dy);
+
+    edge->x = x1 + q;
+    edge->e = n - q * dy;
+    edge->de = ((int64_t)dx << 16) - s * dy;
+    edge->dy = dy;
+    edge->sx = s > INT32_MAX ? INT32_MAX : s < INT32_MIN ? INT32_MIN : s;  // Only steeper than this if less than a row high
+}
+
+// Step an edge down to the next pixel row
+// - edge: The edge
+//
+static inline void step_edge(struct Edge * edge) {
+    edge->x += edge->sx;
+    edge->e += edge->de;
+    if(edge->e >= edge->dy) {
+        edge->x++;
+        edge->e -= edge->dy;
+    }
+}
+
+// Draw a run of spans between two edges
+// - y1: First row
+// - y2: Last row (exclusive)
+// - left, right: The left and right edges, started at y1
+// - c: Pixel colour
+//
+static void draw_spans(int y1, int y2, struct Edge * left, struct Edge * right, unsigned char c) {
+    for(int y = y1; y < y2; y++) {
+        if(y > y1) {
+            step_edge(left);
+            step_edge(right);
+        }
+        int x1 = (left->x + 0x7FFF) >> 16;     // Pixels with their centre on or right of the left edge
+        int x2 = (right->x + 0x7FFF) >> 16;    // Up to, but not including, the right edge
+        if(x1 < x2) {
+            draw_horizontal_line(y, x1, x2 - 1, c);
+        }
+    }
+}
+
+// Draw a filled triangle with subpixel coordinates
+// Coordinates can be anywhere within 16384 pixels of the screen
+// - x1 ... x3: X coordinates (16.16)
+// - y1 ... y3: Y coordinates (16.16)
+// - c: Pixel colour
+//
+void draw_triangle_fixed(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3, unsigned char c) {
+    struct Edge ac, ab;
+    int32_t t;
+
+    if(y1 > y3) {                           // First sort the points by Y ascending
+        t = x1; x1 = x3; x3 = t;
+        t = y1; y1 = y3; y3 = t;
     }
     if(y1 > y2) {
-        swap(&x1, &x2); //b
-        swap(&y1, &y2);
+        t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
     }
-    if(y2 > y3) {       // c
-        swap(&x2, &x3);
-        swap(&y2, &y3);
+    if(y2 > y3) {
+        t = x2; x2 = x3; x3 = t;
+        t = y2; y2 = y3; y3 = t;
     }
-    
-    // Now draw the longest line (a->c) and (a->b) together
-    //
-    init_line(&line1, x1, y1, x3, y3);  // a
-    init_line(&line2, x1, y1, x2, y2);  // b
 
-    while(line2.h > 0) {
-        draw_horizontal_line(line1.yp, line1.xp, line2.xp, c);
-        step_line(&line1);
-        step_line(&line2);
-        line1.yp++;
-        line2.h--;
+    // Pixel rows whose centre is in [y1, y3), clipped to the screen
+    //
+    int top = (y1 + 0x7FFF) >> 16;
+    int mid = (y2 + 0x7FFF) >> 16;
+    int bottom = (y3 + 0x7FFF) >> 16;
+    if(top < 0) {
+        top = 0;
+    }
+    if(bottom > height) {
+        bottom = height;
+    }
+    if(top >= bottom) {
+        return;
     }
+    mid = mid < top ? top : mid > bottom ? bottom : mid;
 
-    // And finish with line b->c
+    // Work out which side of the long edge (a->c) the middle point is on
     //
-    init_line(&line2, x2, y2, x3, y3);  // c
-
-    while(line2.h > 0) {
-        draw_horizontal_line(line1.yp, line1.xp, line2.xp, c);
-        step_line(&line1);
-        step_line(&line2);
-        line1.yp++;
-        line2.h--;
+    int64_t cross = (int64_t)(x2 - x1) * (y3 - y1) - (int64_t)(y2 - y1) * (x3 - x1);
+    if(cross == 0) {                        // No area, so nothing to draw
+        return;
     }
+    bool long_left = cross > 0;
 
-    draw_horizontal_line(line1.yp, line1.xp, line2.xp, c);
+    if(top < mid) {                         // The top half, between a->c and a->b
+        init_edge(&ac, x1, y1, x3, y3, top);
+        init_edge(&ab, x1, y1, x2, y2, top);
+        draw_spans(top, mid, long_left ? &ac : &ab, long_left ? &ab : &ac, c);
+        step_edge(&ac);                     // Carry the long edge on to the next row
+    }
+    else {
+        init_edge(&ac, x1, y1, x3, y3, mid);
+    }
+    if(mid < bottom) {                      // And the bottom half, between a->c and b->c
+        init_edge(&ab, x2, y2, x3, y3, mid);
+        draw_spans(mid, bottom, long_left ? &ac : &ab, long_left ? &ab : &ac, c);
+    }
 }
 
 // Optimised horizontal line
@@ -282,6 +625,9 @@ void draw_triangle(int x1, int y1, int x2, int y2, int x3, int y3, unsigned char
 // - c: Colour
 //
 void draw_horizontal_line(int y1, int x1, int x2, int c) {
+    if(y1 < 0 || y1 >= height) {        // Off the top or bottom of the screen
+        return;
+    }
     if(x1 > x2) {                       // Always draw the line from left to right
         swap(&x2, &x1);
     }
@@ -291,16 +637,16 @@ void draw_horizontal_line(int y1, int x1, int x2, int c) {
         }
         x1 = 0;                         // Clip x1 to 0
     }
-    if(x2 > width) {                    // if x2 > width
-        if(x1 > width) {                // if x1 is also > width
+    if(x2 >= width) {                   // if x2 is off the right hand side
+        if(x1 >= width) {               // if x1 is also off the right hand side
             return;                     // Don't need to draw
         }
-        x2 = width;                     // Clip x2 to width
+        x2 = width - 1;                 // Clip x2 to the last pixel
     }
 //  for(int i = x1; i <= x2; i++) {     // This is slow...
 //      plot(i, y1, c);                 // so we'll use memset to fill the line in memory
 //  }                                  
-    memset(&bitmap[width * y1 + x1], colour_base + c, x2 - x1 + 1);
+    fill_span(bitmap_row(y1), x1, x2, c);
 }
 
 // Swap two numbers
@@ -313,64 +659,6 @@ void swap(int *a, int *b) {
     *b = t;
 }
 
-// Iniitialise a line structure
-// Used for filled triangle routine
-// - line: Pointer to a line structure
-// - x1, y1: Coordinates of start point
-// - x2, y2: Coordinates of last point
-//
-void init_line(struct Line *line, int x1, int y1, int x2, int y2) {
-    line->dx = x2 - x1;
-    line->dy = y2 - y1;
-    line->sx = (line->dx > 0) - (line->dx < 0); // Sign DX
-    line->sy = (line->dy > 0) - (line->dy < 0); // Sign DY
-    line->dx *= line->sx;                       // Abs DX
-    line->dy *= line->sy;                       // Abs DY
-    line->xp = x1;                              // Start pixel coordinates
-    line->yp = y1;
-    line->quad = line->dx > line->dy;           // True if line is longer than taller 
-    line->h = line->dy;
-    if(line->quad) {                   
-        line->e = line->dx >> 1;
-        line->dy -= line->dx;
-    }
-    else {
-        line->e = line->dy >> 1;
-        line->dx -= line->dy;
-    }
-}
-
-// Do one step of the line
-// Used for filled triangle routine
-// - line: Pointer to a line structure
-// Returns
-// - true if the line has incremented onto the next pixel row
-//
-void step_line(struct Line *line) {
-    if(line->quad) {
-        while(true) {
-            line->e += line->dy;
-            if(line->e > 0) {
-                line->xp += line->sx;
-                break;
-            }
-            else {
-                line->xp += line->sx;
-                line->e += line->dx;
-            }
-        }
-    }
-    else {                        
-        line->e += line->dx;
-        if(line->e > 0) {
-            line->xp += line->sx;
-        }
-        else {
-            line->e += line->dy;
-        }
-    }
-}
-
 // Blit (non-scaling)
 // - data: Source data
 // - sx, sy: Source X and Y in array of pixels
@@ -378,11 +666,28 @@ void step_line(struct Line *line) {
 // - dx, dy: Destination X and Y on screen
 //
 void blit(const void * data, int sx, int sy, int sw, int sh, int dx, int dy) {
+    #if opt_4bpp == 1
+    const unsigned char * src = (const unsigned char *)data + (sw * sy) + sx;
+    for(int i = 0; i < sh; i++) {       // The source is one byte per pixel, so pack it
+        unsigned char * dst = bitmap_row(dy + i) + (dx >> 1);
+        int j = 0;
+        if(dx & 1) {                    // An odd start pixel goes in the high nibble
+            *dst = (*dst & 0x0F) | ((src[j++] & 0x0F) << 4);
+            dst++;
+        }
+        for(; j < sw - 1; j += 2) {     // Then pack pairs of pixels into bytes
+            *dst++ = (src[j] & 0x0F) | ((src[j + 1] & 0x0F) << 4);
+        }
+        if(j < sw) {                    // And any pixel left over goes in the low nibble
+            *dst = (*dst & 0xF0) | (src[j] & 0x0F);
+        }
+        src += sw;
+    }
+    #else
     void * src = (void *)data + (sw * sy) + sx;
-    void * dst = bitmap + (width * dy) + dx;
     for(int i = 0; i < sh; i++) {
-        memcpy(dst, src, sw);
-        dst += width;
+        memcpy(bitmap_row(dy + i) + dx, src, sw);
         src += sw;
     }
+    #endif
 }
\ No newline at end of file
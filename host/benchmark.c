@@ -0,0 +1,577 @@
+//
+// Title:	        Pico-mposite Graphics Benchmarks
+// Description:		Times the graphics primitives on the host in each of the video modes
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Checksum the bitmap in screen order
+// 17/10/2026:      Added the terminal benchmark
+// 17/10/2026:      Added the draw queue benchmarks
+// 17/10/2026:      Added small filled triangles
+// 17/10/2026:      Added clipped lines
+// 17/10/2026:      The scenes are transformed in fixed point; added the double precision transform for comparison
+// 17/10/2026:      Added the mesh benchmark
+// 17/10/2026:      Added the Mandelbrot benchmarks
+// 17/10/2026:      Added the Mandelbrot drawing methods
+// 17/10/2026:      Added transparent text, and text in changing colours
+// 17/10/2026:      The terminal benchmark renders once per update, as the terminal does once a frame
+// 17/10/2026:      Added the ANSI terminal benchmark
+// 17/10/2026:      Print the video memory needed by each mode
+// 17/10/2026:      Check the fixed point cube transform against the double precision one
+// 17/10/2026:      Feed the terminal through the fake UART and the firmware's interrupt handler
+// 17/10/2026:      Call initialise_graphics
+// 17/10/2026:      Added the draw queue benchmarks with work on core 0, and the core 0 CPU time
+//
+// Usage: mposite_bench [scale]
+// - scale: Multiplier for the number of iterations of each benchmark (default 1)
+//
+// Each result also prints a checksum of the bitmap, so a change in rasterizer output shows up as a changed checksum,
+// and the CPU time used by core 0 (the main thread), which for the queued benchmarks leaves out the drawing done
+// by core 1
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+
+#include "bitmap.h"
+#include "graphics.h"
+#include "cvideo.h"
+#include "terminal.h"
+#include "serial.h"
+#include "draw_queue.h"
+#include "fixed.h"
+#include "mesh.h"
+#include "mandelbrot.h"
+
+struct Benchmark {
+    const char * name;
+    int iterations;
+    void (*run)(int i);
+    void (*finish)(void);           // Optional; called before the timer is stopped
+};
+
+static uint32_t seed;
+
+// Deterministic pseudo-random number so every run draws the same thing
+// - n: Upper limit (exclusive)
+//
+static int rnd(int n) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) % n;
+}
+
+static void bench_cls(int i) {
+    cls(i & 15);
+}
+
+static void bench_line(int i) {
+    draw_line(rnd(width), rnd(height), rnd(width), rnd(height), i & 15);
+}
+
+static void bench_line_clipped(int i) {
+    draw_line(rnd(width * 3) - width, rnd(height * 3) - height, rnd(width * 3) - width, rnd(height * 3) - height, i & 15);
+}
+
+static void bench_triangle(int i) {
+    draw_triangle(rnd(width), rnd(height), rnd(width), rnd(height), rnd(width), rnd(height), i & 15, false);
+}
+
+static void bench_triangle_filled(int i) {
+    draw_triangle(rnd(width), rnd(height), rnd(width), rnd(height), rnd(width), rnd(height), i & 15, true);
+}
+
+static void bench_triangle_small(int i) {
+    int x = rnd(width - 24), y = rnd(height - 24);
+    draw_triangle(x + rnd(24), y + rnd(24), x + rnd(24), y + rnd(24), x + rnd(24), y + rnd(24), i & 15, true);
+}
+
+static void bench_circle(int i) {
+    int r = 4 + rnd(height / 2 - 8);
+    draw_circle(r + rnd(width - r * 2), r + rnd(height - r * 2), r, i & 15, false);
+}
+
+static void bench_circle_filled(int i) {
+    int r = 4 + rnd(height / 2 - 8);
+    draw_circle(r + rnd(width - r * 2), r + rnd(height - r * 2), r, i & 15, true);
+}
+
+static void bench_print_string(int i) {
+    print_string(rnd(width / 8 - 31) * 8, rnd(height / 8) * 8, "Pico-mposite Graphics Primitives", i & 15, 15 - (i & 15));
+}
+
+static void bench_print_string_transparent(int i) {
+    print_string_transparent(rnd(width / 8 - 31) * 8, rnd(height / 8) * 8, "Pico-mposite Graphics Primitives", i & 15);
+}
+
+// Characters in a different colour each time, as the worst case for the glyph table
+//
+static void bench_print_char_colours(int i) {
+    print_char(rnd(width / 8) * 8, rnd(height / 8) * 8, 'A' + (i & 15), i & 15, (i >> 4) & 15);
+}
+
+static void bench_blit(int i) {
+    blit(&sample_bitmap, 0, rnd(192 - 64), 256, 64, rnd(width - 255), rnd(height - 63));
+}
+
+static void bench_blit_full(int i) {
+    blit(&sample_bitmap, 0, 0, 256, 192, (width - 256) / 2, 0);
+}
+
+static void bench_scroll_up(int i) {
+    scroll_up(i & 15, 8);
+}
+
+// Feed bytes through the fake UART, in half FIFO chunks as the receive interrupt would see them
+//
+static void bench_terminal_receive(const char * s, int length) {
+    for(int j = 0; j < length; j += uart_host_fifo_size / 2) {
+        int n = length - j;
+        uart_host_receive(&s[j], n < uart_host_fifo_size / 2 ? n : uart_host_fifo_size / 2);
+        serial_irq_handler();
+    }
+}
+
+// Receive a line of log output through the UART model and render it
+// The bytes arrive in half FIFO chunks, as the receive interrupt would see them, and the terminal
+// catches up every 16 lines, about a frame's worth at 115200 baud, so is rendered once for those lines
+//
+static void bench_terminal(int i) {
+    static const char line[] = "[sensor 3] reading 0x1234 ok, next in 250ms ..\r\n";
+    bench_terminal_receive(line, sizeof(line) - 1);
+    if((i & 15) == 15) {
+        terminal_update();
+        terminal_render();
+    }
+}
+
+// The same with ANSI escape sequences; a status line is kept at the top of the window and the log,
+// with a coloured tag on each line, scrolls in the region below it
+//
+static void bench_terminal_ansi(int i) {
+    static const char line[] = "\x1b[32m[sensor 3]\x1b[0m reading 0x1234 \x1b[1mok\x1b[22m\x1b[K\r\n";
+    static const char status[] = "\x1b[s\x1b[H\x1b[7m lines 0000 \x1b[K\x1b[0m\x1b[u";
+    if(i == 0) {
+        bench_terminal_receive("\x1b[2r\x1b[24;1H", 11);
+    }
+    bench_terminal_receive(line, sizeof(line) - 1);
+    if((i & 15) == 15) {
+        bench_terminal_receive(status, sizeof(status) - 1);
+        terminal_update();
+        terminal_render();
+    }
+}
+
+// Redraw the whole terminal, as after a change of mode
+//
+static void bench_terminal_redraw(int i) {
+    terminal_redraw();
+    terminal_render();
+}
+
+static const int cube_pts[8][3] = {
+    { -20,  20,  20 }, {  20,  20,  20 }, { -20, -20,  20 }, {  20, -20,  20 },
+    { -20,  20, -20 }, {  20,  20, -20 }, { -20, -20, -20 }, {  20, -20, -20 },
+};
+
+static const int cube_faces[6][4] = {
+    { 0,1,3,2 }, { 6,7,5,4 }, { 1,5,7,3 }, { 2,6,4,0 }, { 2,3,7,6 }, { 0,4,5,1 },
+};
+
+#define scene_direct            0   // Draw the faces straight away
+#define scene_queued            1   // Queue the faces for core 1
+#define scene_transform         2   // Just do the transforms, to see how much there is to overlap
+#define scene_transform_double  3   // Just do the transforms in double precision, as the demos used to
+
+// Transform and project a cube in fixed point, as the spinny cube demo does
+// - the, psi, phi: Rotation angles, in 65536ths of a turn
+// - xo, yo: Position on screen
+// - a, b: The corners on screen
+//
+static void cube_fixed(uint16_t the, uint16_t psi, uint16_t phi, int xo, int yo, int * a, int * b) {
+    struct Projection view = { int_to_fixed(xo), int_to_fixed(yo), int_to_fixed(200), int_to_fixed(256) };
+    struct Vector offset = { 0, 0, 0 };
+    struct Vector v[8];
+    struct Point p[8];
+    struct Matrix3 r;
+    struct Matrix4 m;
+
+    for(int j = 0; j < 8; j++) {
+        v[j].x = int_to_fixed(cube_pts[j][0]);
+        v[j].y = int_to_fixed(cube_pts[j][1]);
+        v[j].z = int_to_fixed(cube_pts[j][2]);
+    }
+    matrix3_rotate(&r, phi, -the, psi);
+    matrix4_set(&m, &r, &offset);
+    transform_vertices(&m, v, v, 8);
+    project_vertices(&view, v, p, 8);
+    for(int j = 0; j < 8; j++) {
+        a[j] = fixed_to_int(p[j].x);
+        b[j] = fixed_to_int(p[j].y);
+    }
+}
+
+// The same in double precision
+//
+static void cube_double(uint16_t the_a, uint16_t psi_a, uint16_t phi_a, int xo, int yo, int * a, int * b) {
+    double the = the_a * M_PI * 2 / angle_full, psi = psi_a * M_PI * 2 / angle_full, phi = phi_a * M_PI * 2 / angle_full;
+
+    for(int j = 0; j < 8; j++) {
+        double xx = cube_pts[j][0], yy = cube_pts[j][1], zz = cube_pts[j][2], x, y;
+         y = yy * cos(phi) - zz * sin(phi);
+        zz = yy * sin(phi) + zz * cos(phi);
+         x = xx * cos(the) - zz * sin(the);
+        zz = xx * sin(the) + zz * cos(the);
+        xx =  x * cos(psi) -  y * sin(psi);
+        yy =  x * sin(psi) +  y * cos(psi);
+        a[j] = xo + xx * 200 / (256 - zz);
+        b[j] = yo + yy * 200 / (256 - zz);
+    }
+}
+
+// Draw a frame of eight spinning filled cubes, like the spinny cube demo
+// - i: Frame number
+// - how: One of the scene_ values
+//
+static volatile int scene_sink;    // Stops the transform being optimised away
+
+static void scene(int i, int how) {
+    if(how == scene_queued) {
+        queue_cls(0);
+    }
+    else if(how == scene_direct) {
+        cls(0);
+    }
+    for(int k = 0; k < 8; k++) {
+        uint16_t the = i * 104 + k * 10430, psi = i * 313 + k * 10430, phi = i * -209 + k * 10430;
+        int xo = (k & 3) * width / 4 + width / 8;
+        int yo = (k >> 2) * height / 2 + height / 4;
+        int a[8], b[8];
+
+        if(how == scene_transform_double) {
+            cube_double(the, psi, phi, xo, yo, a, b);
+        }
+        else {
+            cube_fixed(the, psi, phi, xo, yo, a, b);
+        }
+        for(int f = 0; f < 6; f++) {
+            const int * p = cube_faces[f];
+            if(a[p[0]] * (b[p[1]] - b[p[2]]) + a[p[1]] * (b[p[2]] - b[p[0]]) + a[p[2]] * (b[p[0]] - b[p[1]]) <= 0) {
+                if(how == scene_queued) {
+                    queue_polygon(a[p[0]], b[p[0]], a[p[1]], b[p[1]], a[p[2]], b[p[2]], a[p[3]], b[p[3]], f + 1, true);
+                }
+                else if(how == scene_direct) {
+                    draw_polygon(a[p[0]], b[p[0]], a[p[1]], b[p[1]], a[p[2]], b[p[2]], a[p[3]], b[p[3]], f + 1, true);
+                }
+                else {
+                    scene_sink = f;
+                }
+            }
+        }
+    }
+}
+
+// Check that the fixed point and double precision transforms put the corners in the same place
+// Runs the angles of the first 1000 frames of the scene
+// Returns:
+// - The largest difference in pixels, or -1 if it is over a pixel
+//
+static int check_transforms(void) {
+    int worst = 0;
+
+    for(int i = 0; i < 1000; i++) {
+        for(int k = 0; k < 8; k++) {
+            uint16_t the = i * 104 + k * 10430, psi = i * 313 + k * 10430, phi = i * -209 + k * 10430;
+            int xo = (k & 3) * width / 4 + width / 8;
+            int yo = (k >> 2) * height / 2 + height / 4;
+            int a1[8], b1[8], a2[8], b2[8];
+
+            cube_fixed(the, psi, phi, xo, yo, a1, b1);
+            cube_double(the, psi, phi, xo, yo, a2, b2);
+            for(int j = 0; j < 8; j++) {
+                int d = abs(a1[j] - a2[j]) > abs(b1[j] - b2[j]) ? abs(a1[j] - a2[j]) : abs(b1[j] - b2[j]);
+                if(d > 1) {
+                    fprintf(stderr, "Transform check failed: frame %d cube %d corner %d is (%d,%d), expected (%d,%d)\n",
+                        i, k, j, a1[j], b1[j], a2[j], b2[j]);
+                    return -1;
+                }
+                if(d > worst) {
+                    worst = d;
+                }
+            }
+        }
+    }
+    return worst;
+}
+
+static void bench_scene(int i) {
+    scene(i, scene_direct);
+}
+
+static void bench_scene_transform(int i) {
+    scene(i, scene_transform);
+}
+
+static void bench_scene_transform_double(int i) {
+    scene(i, scene_transform_double);
+}
+
+static void bench_scene_queued(int i) {
+    if(i == 0) {
+        initialise_draw_queue();
+    }
+    scene(i, scene_queued);
+    queue_flip();
+}
+
+static void bench_scene_queued_finish(void) {
+    stop_draw_queue();
+}
+
+// Work for core 0 to do each frame, as a game would; transform and project a 384 vertex mesh eight times
+//
+static void scene_logic(int i) {
+    static const unsigned char colours[1] = { 1 };
+    static struct Vector pts[24 * 16], out[24 * 16];
+    static struct Point screen[24 * 16];
+    static struct Face faces[24 * 16];
+    static struct Mesh torus;
+    struct Projection view = { int_to_fixed(width / 2), int_to_fixed(height / 2), int_to_fixed(256), int_to_fixed(256) };
+    struct Vector offset = { 0, 0, 0 };
+    struct Matrix3 r;
+    struct Matrix4 m;
+
+    if(torus.vertex_count == 0) {
+        mesh_torus(&torus, pts, faces, 24, 16, int_to_fixed(48), int_to_fixed(24), colours, 1);
+    }
+    for(int j = 0; j < 8; j++) {
+        matrix3_rotate(&r, i * 150 + j, i * 50, i * 250);
+        matrix4_set(&m, &r, &offset);
+        transform_vertices(&m, torus.vertices, out, torus.vertex_count);
+        project_vertices(&view, out, screen, torus.vertex_count);
+        scene_sink = screen[j].x;
+    }
+}
+
+static void bench_scene_logic(int i) {
+    scene_logic(i);
+    scene(i, scene_direct);
+}
+
+// The same with the drawing queued for core 1, a frame behind core 0, as the spinny cube demo does
+//
+static void bench_scene_logic_queued(int i) {
+    static uint32_t fence;
+
+    if(i == 0) {
+        initialise_draw_queue();
+        fence = 0;
+    }
+    scene_logic(i);
+    scene(i, scene_queued);
+    queue_wait(fence);
+    fence = queue_flip();
+}
+
+// Draw 24 lines of 32 characters of text
+//
+static void bench_text(int i) {
+    for(int y = 0; y < 24; y++) {
+        print_string(0, y * 8, "Pico-mposite Graphics Primitives", y + i, 0);
+    }
+}
+
+static void bench_text_queued(int i) {
+    if(i == 0) {
+        initialise_draw_queue();
+    }
+    for(int y = 0; y < 24; y++) {
+        queue_print_string(0, y * 8, "Pico-mposite Graphics Primitives", y + i, 0);
+    }
+}
+
+// Draw a frame of a spinning torus of 24 x 16 faces
+//
+static void bench_mesh(int i) {
+    static const unsigned char colours[3] = { 5, 10, 15 };
+    static struct Vector pts[24 * 16];
+    static struct Face faces[24 * 16];
+    static struct Mesh torus;
+    struct Projection view = { int_to_fixed(width / 2), int_to_fixed(height / 2), int_to_fixed(256), int_to_fixed(256) };
+    struct Vector offset = { 0, 0, 0 };
+    struct Matrix3 r;
+    struct Matrix4 m;
+
+    if(i == 0) {
+        mesh_torus(&torus, pts, faces, 24, 16, int_to_fixed(48), int_to_fixed(24), colours, 3);
+    }
+    cls(0);
+    matrix3_rotate(&r, i * 150, i * 50, i * 250);
+    matrix4_set(&m, &r, &offset);
+    render_mesh(&torus, &m, &view, true);
+}
+
+static const unsigned char mandelbrot_colours[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+// Draw the whole Mandelbrot set, as the demo starts with
+// - method: The drawing method
+//
+static void mandelbrot(int method) {
+    struct MandelbrotView view = {
+        .x = float_to_q28(-0.72), .y = 0, .step = float_to_q28(1.0 / 80), .iterations = 32,
+        .colours = mandelbrot_colours, .colour_count = 16, .method = method,
+    };
+    draw_mandelbrot(&view);
+}
+
+// Draw a zoomed in view, with more of the set in it and a higher iteration limit
+// - method: The drawing method
+//
+static void mandelbrot_zoom(int method) {
+    struct MandelbrotView view = {
+        .x = float_to_q28(-0.7453), .y = float_to_q28(0.1127), .step = float_to_q28(1.0 / 80) >> 6, .iterations = 128,
+        .colours = mandelbrot_colours, .colour_count = 16, .method = method,
+    };
+    draw_mandelbrot(&view);
+}
+
+static void bench_mandelbrot(int i) {
+    mandelbrot(mandelbrot_subdivide);
+}
+
+static void bench_mandelbrot_scan(int i) {
+    mandelbrot(mandelbrot_scan);
+}
+
+static void bench_mandelbrot_zoom(int i) {
+    mandelbrot_zoom(mandelbrot_subdivide);
+}
+
+static void bench_mandelbrot_zoom_scan(int i) {
+    mandelbrot_zoom(mandelbrot_scan);
+}
+
+static struct Benchmark benchmarks[] = {
+    { "cls",                  2000, bench_cls },
+    { "draw_line",          200000, bench_line },
+    { "draw_line clipped",  200000, bench_line_clipped },
+    { "draw_triangle",       50000, bench_triangle },
+    { "draw_triangle fill",  50000, bench_triangle_filled },
+    { "draw_triangle small", 200000, bench_triangle_small },
+    { "draw_circle",        100000, bench_circle },
+    { "draw_circle fill",    20000, bench_circle_filled },
+    { "print_string",        50000, bench_print_string },
+    { "print_string transparent", 50000, bench_print_string_transparent },
+    { "print_char colours", 200000, bench_print_char_colours },
+    { "blit 256x64",         50000, bench_blit },
+    { "blit 256x192",         5000, bench_blit_full },
+    { "scroll_up",            2000, bench_scroll_up },
+    { "terminal 48B line",   20000, bench_terminal },
+    { "terminal ansi",       20000, bench_terminal_ansi },
+    { "terminal redraw",      2000, bench_terminal_redraw },
+    { "scene 8 cubes",        2000, bench_scene },
+    { "scene 8 cubes xform",  2000, bench_scene_transform },
+    { "scene 8 cubes xform double", 2000, bench_scene_transform_double },
+    { "scene 8 cubes queued", 2000, bench_scene_queued, bench_scene_queued_finish },
+    { "scene + logic",        2000, bench_scene_logic },
+    { "scene + logic queued", 2000, bench_scene_logic_queued, bench_scene_queued_finish },
+    { "text 24 lines",       10000, bench_text },
+    { "text 24 lines queued", 10000, bench_text_queued, bench_scene_queued_finish },
+    { "mesh torus 384 faces", 2000, bench_mesh },
+    { "mandelbrot",             20, bench_mandelbrot },
+    { "mandelbrot scan",        20, bench_mandelbrot_scan },
+    { "mandelbrot zoom",        20, bench_mandelbrot_zoom },
+    { "mandelbrot zoom scan",   20, bench_mandelbrot_zoom_scan },
+};
+
+// Get a monotonic time in nanoseconds
+//
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Get the CPU time used by this thread in nanoseconds
+//
+static double thread_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// FNV-1a hash of the bitmap
+//
+static uint32_t checksum(void) {
+    uint32_t h = 2166136261u;
+    for(int y = 0; y < height; y++) {       // In screen order, so the hardware scroll does not affect it
+        unsigned char * row = bitmap_row(y);
+        for(int i = 0; i < stride; i++) {
+            h = (h ^ row[i]) * 16777619u;
+        }
+    }
+    return h;
+}
+
+int main(int argc, char ** argv) {
+    int scale = argc > 1 ? atoi(argv[1]) : 1;
+
+    initialise_graphics();
+    if(scale < 1 || initialise_cvideo() != 0) {
+        fprintf(stderr, "Usage: %s [scale]\n", argv[0]);
+        return 1;
+    }
+    initialise_terminal();
+    printf("Bitmap: %d bits per pixel\n", pixel_bits);
+    printf("%-4s %-8s %-26s %10s %12s %10s %12s\n", "Mode", "Size", "Primitive", "Calls", "ns/call", "Checksum", "Core 0 ns");
+
+    for(int mode = 0; mode < 3; mode++) {
+        if(set_mode(mode) != 0) {
+            fprintf(stderr, "Could not set mode %d\n", mode);
+            return 1;
+        }
+        terminal_redraw();                  // Fit the terminal to the new mode
+        int error = check_transforms();
+        if(error < 0) {
+            return 1;
+        }
+        printf("%-4d Transform check: fixed point corners within %dpx of double precision\n", mode, error);
+        for(int b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+            struct Benchmark * bm = &benchmarks[b];
+            int n = bm->iterations * scale;
+            char size[16];
+
+            seed = 1;
+            cls(0);
+            double t = now_ns();
+            double t0 = thread_ns();
+            for(int i = 0; i < n; i++) {
+                bm->run(i);
+            }
+            if(bm->finish) {
+                bm->finish();
+            }
+            t0 = thread_ns() - t0;
+            t = now_ns() - t;
+            snprintf(size, sizeof(size), "%dx%d", width, height);
+            printf("%-4d %-8s %-26s %10d %12.1f   %08x %12.1f\n", mode, size, bm->name, n, t / n, checksum(), t0 / n);
+        }
+    }
+    for(int i = 0; i < 3; i++) {
+        static const int widths[] = { 256, 320, 640 };
+        printf("Video memory: %dx%d needs %u bytes, %u double buffered, of %u\n", widths[i], display_lines,
+            mode_memory_size(widths[i], 0, false), mode_memory_size(widths[i], 0, true), opt_video_memory);
+    }
+    printf("Serial: %u received, %u overflow, %u overrun\n", serial_stats.received, serial_stats.overflow, serial_stats.overrun);
+    return 0;
+}
@@ -0,0 +1,121 @@
+//
+// Title:	        Pico-mposite Host Framebuffer
+// Description:		Stands in for cvideo.c when building the graphics library on the host
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Added scroll_offset and set_scroll
+// 17/10/2026:      Added display batch stubs
+// 17/10/2026:      Added display list stubs for the terminal window
+// 17/10/2026:      Added flip stubs for the draw queue
+// 17/10/2026:      Added vblank_count; wait_vblank counts a frame
+// 17/10/2026:      The bitmap is now laid out in the video memory, as on the Pico; added mode_memory_size
+
+#include "pico/stdlib.h"
+
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#include "cvideo.h"
+#include "video_memory.h"
+
+unsigned char * bitmap;         // Bitmap buffer that the graphics primitives draw to
+unsigned char * bitmap_front;   // There is no scan-out on the host, so this is always the same as bitmap
+
+bool double_buffered = false;
+
+int width = 256;                // Bitmap dimensions
+int height = 192;
+int stride = 256 * pixel_bits / 8;
+int display_lines = 192;
+int scroll_offset = 0;          // There is no display list on the host, so this only affects bitmap_row
+volatile uint vblank_count;
+
+// Lay out the framebuffer in the video memory
+// The display lists are laid out as they are on the Pico, so the memory used is the same, but are not used
+// - w: The width in pixels
+// Returns:
+// - 0 if successful, -1 if there is not enough video memory
+//
+static int framebuffer_layout(int w) {
+    struct VideoLayout layout;
+
+    if(!video_memory_plan(&layout, w * pixel_bits / 8, height, display_lines, display_lines + 1, false)) {
+        return -1;
+    }
+    video_memory_commit(&layout);
+    width = w;
+    stride = width * pixel_bits / 8;
+    scroll_offset = 0;
+    bitmap = bitmap_front = layout.bitmap;
+    return 0;
+}
+
+int initialise_cvideo(void) {
+    return framebuffer_layout(width);
+}
+
+// Set the graphics mode
+// mode - The graphics mode (0 = 256x192, 1 = 320 x 192, 2 = 640 x 192)
+//
+int set_mode(int mode) {
+    switch(mode) {
+        case 1:
+            return framebuffer_layout(320);
+        case 2:
+            return framebuffer_layout(640);
+        default:
+            return framebuffer_layout(256);
+    }
+}
+
+// Get the video memory needed for a mode
+//
+uint32_t mode_memory_size(int w, int flags, bool double_buffered) {
+    int h = flags & mode_line_double ? display_lines / 2 : display_lines;
+
+    return video_layout_size(w * pixel_bits / 8, h, display_lines, display_lines + 1, double_buffered);
+}
+
+void wait_vblank(void) {      // There are no frames on the host, so just count one
+    vblank_count++;
+}
+
+// The host framebuffer is never double buffered, so there is nothing to swap
+//
+void flip(bool wait) {
+}
+
+void wait_flip(void) {
+}
+
+// There is no scan-out on the host, so the display list is not kept
+//
+void set_display_lines(int line, int count, unsigned char * buffer, int row, int rows, int repeat) {
+}
+
+void commit_display_list(bool wait) {
+}
+
+void begin_display_batch(void) {
+}
+
+void end_display_batch(void) {
+}
+
+// Set the hardware scroll
+// - offset: The bitmap row to show at the top of the screen
+//
+void set_scroll(int offset) {
+    offset %= height;
+    if(offset < 0) {
+        offset += height;
+    }
+    scroll_offset = offset;
+}
+
+void set_border(unsigned char colour) {
+}
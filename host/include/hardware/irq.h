@@ -0,0 +1,28 @@
+//
+// Title:	        Pico-mposite Host Stubs
+// Description:		Just enough of the Pico SDK for the graphics library to build on the host
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Added the calls serial.c uses to set up the UART interrupt
+//
+
+#pragma once
+
+#include "pico/stdlib.h"
+
+typedef void (*irq_handler_t)(void);
+
+#define UART0_IRQ                   20
+#define PICO_DEFAULT_IRQ_PRIORITY   0x80
+
+static inline void irq_set_exclusive_handler(uint num, irq_handler_t handler) {    // There are no interrupts on the host
+}
+
+static inline void irq_set_priority(uint num, uint8_t hardware_priority) {
+}
+
+static inline void irq_set_enabled(uint num, bool enabled) {
+}
@@ -0,0 +1,16 @@
+//
+// Title:	        Pico-mposite Host Stubs
+// Description:		Just enough of the Pico SDK for the graphics library to build on the host
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+
+#pragma once
+
+#include "pico/stdlib.h"
+
+typedef struct pio_hw pio_hw_t;
+typedef pio_hw_t * PIO;
@@ -0,0 +1,64 @@
+//
+// Title:	        Pico-mposite Host Stubs
+// Description:		Just enough of the Pico SDK for the graphics library to build on the host
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+// A fake UART with a 32 entry receive FIFO, so the firmware's serial.c runs unchanged on the host. Each FIFO
+// entry is a data register value, with the error flags in the same bits as the PL011. Reading the data
+// register cannot be trapped in C, so uart_is_readable loads the next entry into dr, which is how serial.c
+// reads it: uart_is_readable, then dr, for each byte
+//
+
+#pragma once
+
+#include "pico/stdlib.h"
+
+#define uart_host_fifo_size             32      // The same as the RP2040 UART receive FIFO
+
+#define UART_UARTDR_OE_BITS             0x00000800
+#define UART_UARTDR_BE_BITS             0x00000400
+#define UART_UARTDR_PE_BITS             0x00000200
+#define UART_UARTDR_FE_BITS             0x00000100
+#define UART_UARTIFLS_RXIFLSEL_LSB      3
+#define UART_UARTIFLS_RXIFLSEL_BITS     0x00000038
+
+#define GPIO_FUNC_UART                  2
+
+typedef struct {
+    volatile uint32_t dr;           // The FIFO entry being read
+    volatile uint32_t ifls;         // The FIFO interrupt level; not used
+} uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_hw_t uart_host_hw;
+
+#define uart0   ((uart_inst_t *)&uart_host_hw)
+
+void uart_host_reset(void);
+void uart_host_receive(const void * data, uint32_t n);
+void uart_host_receive_error(unsigned char c, uint32_t flags);
+bool uart_is_readable(uart_inst_t * uart);
+
+static inline uart_hw_t * uart_get_hw(uart_inst_t * uart) {
+    return (uart_hw_t *)uart;
+}
+
+static inline uint uart_init(uart_inst_t * uart, uint baud) {     // Empties the FIFO; the baud rate is ignored
+    uart_host_reset();
+    return baud;
+}
+
+static inline void uart_set_irq_enables(uart_inst_t * uart, bool rx_has_data, bool tx_needs_data) {
+}
+
+static inline void hw_write_masked(volatile uint32_t * addr, uint32_t values, uint32_t write_mask) {
+    *addr = (*addr & ~write_mask) | (values & write_mask);
+}
+
+static inline void gpio_set_function(uint gpio, uint fn) {
+}
@@ -0,0 +1,37 @@
+//
+// Title:	        Pico-mposite Host Stubs
+// Description:		Core 1 is run as a thread on the host
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Core 1 now runs as a thread, for the draw queue benchmarks
+//
+// multicore_reset_core1 cannot stop a thread, so the entry function must return by itself before the
+// next multicore_launch_core1
+//
+
+#pragma once
+
+#include <pthread.h>
+
+static pthread_t multicore_core1;
+static bool multicore_core1_running;
+
+static void * multicore_core1_thread(void * entry) {
+    ((void (*)(void))entry)();
+    return NULL;
+}
+
+static inline void multicore_reset_core1(void) {
+    if(multicore_core1_running) {
+        pthread_join(multicore_core1, NULL);
+        multicore_core1_running = false;
+    }
+}
+
+static inline void multicore_launch_core1(void (*entry)(void)) {
+    multicore_reset_core1();
+    multicore_core1_running = pthread_create(&multicore_core1, NULL, multicore_core1_thread, (void *)entry) == 0;
+}
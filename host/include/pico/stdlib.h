@@ -0,0 +1,48 @@
+//
+// Title:	        Pico-mposite Host Stubs
+// Description:		Just enough of the Pico SDK for the graphics library to build on the host
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Added memory fences and tight_loop_contents for the ring buffer
+// 17/10/2026:      tight_loop_contents yields, as core 1 is a thread on the host
+// 17/10/2026:      Added time_us_32
+// 17/10/2026:      Added __sev and __wfe
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+typedef unsigned int uint;
+
+static inline void __mem_fence_acquire(void) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+static inline void __mem_fence_release(void) {
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void tight_loop_contents(void) {     // Give the other thread a go if there is only one CPU
+    sched_yield();
+}
+
+static inline void __sev(void) {                   // There are no events on the host
+}
+
+static inline void __wfe(void) {                   // So waiting for one just yields
+    sched_yield();
+}
+
+static inline uint32_t time_us_32(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
@@ -0,0 +1,198 @@
+//
+// Title:	        Pico-mposite Serial Tests
+// Description:		Checks serial.c on the host, feeding its interrupt handler from a fake UART
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+// Usage: mposite_serial_test
+// Returns 0 if all the tests pass
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pico/stdlib.h"
+
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+
+#include "cvideo.h"
+#include "graphics.h"
+#include "terminal.h"
+#include "serial.h"
+
+#define test_baud           921600
+#define test_bytes_per_ms   (test_baud / 10 / 1000)     // 10 bits a byte with the start and stop bits
+#define test_frame_ms       20                          // The terminal drains the buffer once a frame at 50Hz
+
+static int failures;
+
+#define check(condition) do { \
+    if(!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+static uint32_t seed;
+
+static unsigned char next_byte(void) {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+// Receive bytes on the line for a number of milliseconds at test_baud
+// The receive interrupt runs each time the FIFO is half full, as it is set up to on the Pico
+// - ms: The time
+// - sent: Filled in with the bytes, if not NULL
+// - text: True for printable characters only, so the terminal does not see a Ctrl+C
+//
+static void receive(int ms, unsigned char * sent, bool text) {
+    for(int i = 0; i < ms * test_bytes_per_ms; i += uart_host_fifo_size / 2) {
+        unsigned char chunk[uart_host_fifo_size / 2];
+        for(int j = 0; j < uart_host_fifo_size / 2; j++) {
+            chunk[j] = text ? ' ' + next_byte() % 95 : next_byte();
+            if(sent != NULL) {
+                *sent++ = chunk[j];
+            }
+        }
+        uart_host_receive(chunk, sizeof(chunk));
+        serial_irq_handler();
+    }
+}
+
+// Receive at test_baud for a few seconds, reading the buffer every few frames, and check every byte comes out
+// - frames: Frames between reads; more than one is a reader that has fallen behind
+//
+static void test_no_loss(int frames) {
+    static unsigned char sent[opt_serial_buffer_size * 2];
+    static unsigned char read[opt_serial_buffer_size * 2];
+    int ms = frames * test_frame_ms;
+
+    initialise_serial(test_baud);
+    seed = 1;
+    for(int t = 0; t < 5000; t += ms) {
+        uint32_t n = ms * test_bytes_per_ms / (uart_host_fifo_size / 2) * (uart_host_fifo_size / 2);
+        receive(ms, sent, false);
+        check(serial_read(read, sizeof(read)) == n);
+        check(memcmp(sent, read, n) == 0);
+    }
+    check(serial_stats.overflow == 0);
+    check(serial_stats.overrun == 0);
+}
+
+// Receive at test_baud through the terminal, which reads and draws once a frame
+//
+static void test_terminal(void) {
+    initialise_serial(test_baud);
+    terminal_redraw();
+    seed = 1;
+    for(int t = 0; t < 5000; t += test_frame_ms) {
+        receive(test_frame_ms, NULL, true);
+        check(terminal_update() >= 0);
+        terminal_render();
+        check(serial_available() == 0);
+    }
+    check(serial_stats.received == 5000 / test_frame_ms * (test_frame_ms * test_bytes_per_ms / (uart_host_fifo_size / 2)) * (uart_host_fifo_size / 2));
+    check(serial_stats.overflow == 0);
+    check(serial_stats.overrun == 0);
+}
+
+// Fill the ring buffer past the top, and check the bytes that do not fit are counted and the rest are kept
+//
+static void test_overflow(void) {
+    static unsigned char read[opt_serial_buffer_size];
+    uint32_t extra = 100;
+
+    initialise_serial(test_baud);
+    for(uint32_t i = 0; i < opt_serial_buffer_size + extra; i++) {
+        unsigned char c = i;
+        uart_host_receive(&c, 1);
+        serial_irq_handler();
+    }
+    check(serial_stats.received == opt_serial_buffer_size + extra);
+    check(serial_stats.overflow == extra);
+    check(serial_stats.overrun == 0);
+    check(serial_read(read, sizeof(read)) == opt_serial_buffer_size);
+    for(int i = 0; i < opt_serial_buffer_size; i++) {
+        check(read[i] == (unsigned char)i);
+    }
+}
+
+// Fill the UART FIFO past the top before the interrupt runs, and check the overrun is counted once
+// The UART flags it on the first byte to get into the FIFO after the lost ones
+//
+static void test_overrun(void) {
+    unsigned char data[uart_host_fifo_size + 5];
+    unsigned char read[sizeof(data)];
+
+    initialise_serial(test_baud);
+    for(int i = 0; i < uart_host_fifo_size + 5; i++) {
+        data[i] = i;
+    }
+    uart_host_receive(data, sizeof(data));
+    serial_irq_handler();
+    check(serial_stats.overrun == 0);
+    check(serial_stats.received == uart_host_fifo_size);
+    check(serial_read(read, sizeof(read)) == uart_host_fifo_size);
+    check(memcmp(data, read, uart_host_fifo_size) == 0);
+
+    uart_host_receive(data, 1);
+    serial_irq_handler();
+    check(serial_stats.overrun == 1);
+    check(serial_stats.received == uart_host_fifo_size + 1);
+    check(serial_stats.overflow == 0);
+
+    uart_host_receive(data, uart_host_fifo_size);       // A full FIFO with nothing lost is not an overrun
+    serial_irq_handler();
+    uart_host_receive(data, 1);
+    serial_irq_handler();
+    check(serial_stats.overrun == 1);
+    check(serial_stats.received == uart_host_fifo_size * 2 + 2);
+}
+
+// Receive bytes with framing, parity and break errors, and check they are counted and dropped
+//
+static void test_errors(void) {
+    unsigned char read[8];
+
+    initialise_serial(test_baud);
+    uart_host_receive("a", 1);
+    uart_host_receive_error('b', UART_UARTDR_FE_BITS);
+    uart_host_receive_error('c', UART_UARTDR_PE_BITS);
+    uart_host_receive_error(0, UART_UARTDR_BE_BITS);
+    uart_host_receive("d", 1);
+    serial_irq_handler();
+    check(serial_stats.errors == 3);
+    check(serial_stats.received == 2);
+    check(serial_read(read, sizeof(read)) == 2);
+    check(read[0] == 'a' && read[1] == 'd');
+}
+
+int main(void) {
+    initialise_graphics();
+    if(initialise_cvideo() != 0 || set_mode(2) != 0) {
+        fprintf(stderr, "Could not set up the video\n");
+        return 1;
+    }
+    initialise_terminal();
+
+    test_no_loss(1);
+    test_no_loss(4);                        // 80ms of data fits in the buffer, so a reader that stalls is fine
+    test_terminal();
+    test_overflow();
+    test_overrun();
+    test_errors();
+
+    if(failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("Serial tests passed\n");
+    return 0;
+}
@@ -0,0 +1,79 @@
+//
+// Title:	        Pico-mposite Host UART
+// Description:		A fake UART receive FIFO for running serial.c on the host
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+// Bytes "arrive on the line" through uart_host_receive into the FIFO, and calling serial_irq_handler empties
+// it into the ring buffer, as the receive interrupt does on the Pico. Calling these in different patterns shows
+// how the buffering copes with the reader falling behind
+//
+
+#include "pico/stdlib.h"
+
+#include "hardware/uart.h"
+
+uart_hw_t uart_host_hw;
+
+static uint32_t uart_fifo[uart_host_fifo_size];
+static uint32_t uart_fifo_head;
+static uint32_t uart_fifo_count;
+static bool uart_overrun;           // A byte was lost; flagged on the next byte that gets into the FIFO
+
+// Empty the FIFO
+//
+void uart_host_reset(void) {
+    uart_fifo_head = 0;
+    uart_fifo_count = 0;
+    uart_overrun = false;
+}
+
+// Put an entry in the FIFO
+// Bytes that arrive while the FIFO is full are lost, and the overrun flag is set on the next one that is not,
+// as on the PL011
+// - data: The data register value
+//
+static void uart_host_push(uint32_t data) {
+    if(uart_fifo_count == uart_host_fifo_size) {
+        uart_overrun = true;
+        return;
+    }
+    if(uart_overrun) {
+        data |= UART_UARTDR_OE_BITS;
+        uart_overrun = false;
+    }
+    uart_fifo[(uart_fifo_head + uart_fifo_count++) % uart_host_fifo_size] = data;
+}
+
+// Receive bytes
+// - data: The bytes
+// - n: Number of bytes
+//
+void uart_host_receive(const void * data, uint32_t n) {
+    for(uint32_t i = 0; i < n; i++) {
+        uart_host_push(((const unsigned char *)data)[i]);
+    }
+}
+
+// Receive a byte with a framing, parity or break error
+// - c: The byte
+// - flags: Any of UART_UARTDR_FE_BITS, UART_UARTDR_PE_BITS and UART_UARTDR_BE_BITS
+//
+void uart_host_receive_error(unsigned char c, uint32_t flags) {
+    uart_host_push(c | flags);
+}
+
+// Check for a byte in the FIFO, and load it into the data register if there is one
+//
+bool uart_is_readable(uart_inst_t * uart) {
+    if(uart_fifo_count == 0) {
+        return false;
+    }
+    uart_get_hw(uart)->dr = uart_fifo[uart_fifo_head];
+    uart_fifo_head = (uart_fifo_head + 1) % uart_host_fifo_size;
+    uart_fifo_count--;
+    return true;
+}
@@ -3,14 +3,23 @@
 // Description:		A hacked-together composite video output for the Raspberry Pi Pico
 // Author:	        Dean Belfield
 // Created:	        02/02/2021
-// Last Updated:	01/03/2022
+// Last Updated:	17/10/2026
 // 
 // Modinfo:
 // 04/02/2022:      Demos now set the border colour
 // 05/02/2022:      Added support for colour
 // 20/02/2022:      Added demo_terminal
 // 01/03/2022:      Added colour to the demos
+// 17/10/2026:      The spinny cube demo is now double buffered
+// 17/10/2026:      Added demo_terminal_split
+// 17/10/2026:      The spinny cube demo now draws on core 1 through the draw queue
+// 17/10/2026:      The spinny cube is now transformed in fixed point
+// 17/10/2026:      Added demo_mesh
+// 17/10/2026:      The Mandlebrot demo now draws in fixed point on both cores, and zooms in
+// 17/10/2026:      Lines sent to the terminal now end in CR LF
+// 17/10/2026:      Call initialise_graphics before starting anything
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 
@@ -25,20 +34,24 @@
 #include "graphics.h"
 #include "cvideo.h"
 #include "terminal.h"
+#include "draw_queue.h"
+#include "fixed.h"
+#include "mesh.h"
+#include "mandelbrot.h"
 
 #include "main.h"
 
 // Cube corner points
 //
-int shape_pts[8][8] = {
-    { -20,  20,  20 },
-    {  20,  20,  20 },
-    { -20, -20,  20 },
-    {  20, -20,  20 },
-    { -20,  20, -20 },
-    {  20,  20, -20 },
-    { -20, -20, -20 },
-    {  20, -20, -20 },
+struct Vector shape_pts[8] = {
+    { int_to_fixed(-20), int_to_fixed( 20), int_to_fixed( 20) },
+    { int_to_fixed( 20), int_to_fixed( 20), int_to_fixed( 20) },
+    { int_to_fixed(-20), int_to_fixed(-20), int_to_fixed( 20) },
+    { int_to_fixed( 20), int_to_fixed(-20), int_to_fixed( 20) },
+    { int_to_fixed(-20), int_to_fixed( 20), int_to_fixed(-20) },
+    { int_to_fixed( 20), int_to_fixed( 20), int_to_fixed(-20) },
+    { int_to_fixed(-20), int_to_fixed(-20), int_to_fixed(-20) },
+    { int_to_fixed( 20), int_to_fixed(-20), int_to_fixed(-20) },
 };
 
 // Cube polygons (lines between corners + colour)
@@ -58,6 +71,8 @@ unsigned char col_mandelbrot[16] = {
     0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
 };
 
+unsigned char col_torus[2] = { col_grey, col_white };
+
 #else
 
 int shape[6][5] = {
@@ -88,11 +103,14 @@ unsigned char col_mandelbrot[16] = {
     rgb(7,7,0)
 };
 
+unsigned char col_torus[2] = { col_red, col_yellow };
+
 #endif
 
 // The main loop
 //
 int main() {
+    initialise_graphics();  // Build the glyph table, before core 1 is started
     initialise_cvideo();    // Initialise the composite video stuff
     //
     // And then just loop doing your thing
@@ -101,8 +119,11 @@ int main() {
         demo_splash();
         #if opt_terminal == 1
         demo_terminal();
+        #elif opt_terminal == 2
+        demo_terminal_split();
         #else 
         demo_spinny_cube();
+        demo_mesh();
         demo_mandlebrot(); 
         #endif
     }
@@ -128,100 +149,129 @@ void demo_splash() {
 // Demo: Spinning 3D cube
 //
 void demo_spinny_cube() {
-    double the = 0;
-    double psi = 0;
-    double phi = 0;
+    uint16_t the = 0;           // Angles in 65536ths of a turn
+    uint16_t psi = 0;
+    uint16_t phi = 0;
+
+    uint32_t fence = 0;
 
     set_border(col_white);
+    set_double_buffer(true);    // Draw off-screen and flip; falls back to a single buffer if there is no memory
+    initialise_draw_queue();    // Core 1 draws each frame while core 0 works out the next one
 
     for(int i = 0; i < 1000; i++) {
-        wait_vblank();
-        cls(col_white);
+        queue_cls(col_white);
         #if opt_colour == 0
-        print_string(0, 180, "Pico-mposite Graphics Primitives", 15, 0);
+        queue_print_string(0, 180, "Pico-mposite Graphics Primitives", 15, 0);
         #else
-        print_string(0, 180, "Pico-mposite Graphics Primitives", col_blue, col_white);
+        queue_print_string(0, 180, "Pico-mposite Graphics Primitives", col_blue, col_white);
         #endif 
-        draw_circle(128, 96, 80, i >= 500 ? col_grey : col_black, i >= 500);
+        queue_circle(128, 96, 80, i >= 500 ? col_grey : col_black, i >= 500);
         render_spinny_cube(0, 0, the, psi, phi, i >= 500);
-        the += 0.01;
-        psi += 0.03;
-        phi -= 0.02;
+        queue_wait(fence);      // Stay no more than a frame ahead of core 1
+        fence = queue_flip();
+        the += 104;             // About 0.01, 0.03 and -0.02 radians a frame
+        psi += 313;
+        phi -= 209;
+    }
+    stop_draw_queue();
+    set_double_buffer(false);
+}
+
+// Demo: Spinning torus
+// This is a mesh of 288 faces, so needs the faces sorting by depth
+//
+void demo_mesh(void) {
+    static struct Vector torus_pts[24 * 12];
+    static struct Face torus_faces[24 * 12];
+    struct Projection view = { int_to_fixed(width / 2), int_to_fixed(height / 2), int_to_fixed(256), int_to_fixed(256) };
+    struct Vector offset = { 0, 0, 0 };
+    struct Mesh torus;
+    struct Matrix3 r;
+    struct Matrix4 m;
+    uint16_t the = 0;
+    uint16_t psi = 0;
+
+    mesh_torus(&torus, torus_pts, torus_faces, 24, 12, int_to_fixed(48), int_to_fixed(20), col_torus, 2);
+    set_border(col_black);
+    set_double_buffer(true);
+
+    for(int i = 0; i < 1000; i++) {
+        cls(col_black);
+        matrix3_rotate(&r, the, 0, psi);
+        matrix4_set(&m, &r, &offset);
+        render_mesh(&torus, &m, &view, true);
+        print_string_transparent(0, 180, "Pico-mposite Mesh Demo", col_white);
+        flip(true);
+        the += 150;
+        psi += 250;
     }
+    set_double_buffer(false);
 }
 
 // Demo: Mandlebrot set
 //
 void demo_mandlebrot() {
+    struct MandelbrotView view = {
+        .x = float_to_q28(-0.72), .y = 0, .step = float_to_q28(1.0 / 80), .iterations = 32,
+        .colours = col_mandelbrot, .colour_count = 16,
+    };
+    char s[32];
+
     cls(col_black);
     set_border(col_black);
-    render_mandlebrot();
-    #if opt_colour == 0
-    print_string(16, 180, "Pico-mposite Mandlebrot Demo", 0, 15);
-    #else
-    print_string(16, 180, "Pico-mposite Mandlebrot Demo", col_red, col_white);
-    #endif
-    sleep_ms(10000);
+    for(int i = 0; i < 10; i++) {
+        uint32_t t = draw_mandelbrot(&view);
+        snprintf(s, sizeof(s), "%ld.%03ldms", (long)(t / 1000), (long)(t % 1000));
+        #if opt_colour == 0
+        print_string(16, 180, "Pico-mposite Mandlebrot Demo", 0, 15);
+        print_string(16, 0, s, 0, 15);
+        #else
+        print_string(16, 180, "Pico-mposite Mandlebrot Demo", col_red, col_white);
+        print_string(16, 0, s, col_red, col_white);
+        #endif
+        sleep_ms(i == 0 ? 5000 : 1000);
+        if(i == 0) {            // Then zoom in on seahorse valley
+            view.x = float_to_q28(-0.7453);
+            view.y = float_to_q28(0.1127);
+        }
+        zoom_mandelbrot(&view, width / 2, height / 2, 1);
+        view.iterations += 16;
+    }
 }
 
 // Draw a 3D cube
+// The faces are queued for core 1 to draw
 // xo: X position in view
 // yo: Y position in view
-// the, psi, phi: Rotation angles
+// the, psi, phi: Rotation angles, in 65536ths of a turn
 // colour: Pixel colour
 //
-void render_spinny_cube(int xo, int yo, double the, double psi, double phi, bool filled) {
-    int i;
-    double x, y, z, xx, yy, zz;
-    int a[8], b[8];
-    int xd =0, yd = 0;
-    int x1, y1, x2, y2, x3, y3, x4, y4;
-    double sd = 512, od = 256;
-
-    for(i = 0; i < 8 ; i++) {
-        xx = shape_pts[i][0];
-        yy = shape_pts[i][1];
-        zz = shape_pts[i][2];
-
-         y = yy * cos(phi) - zz * sin(phi);
-        zz = yy * sin(phi) + zz * cos(phi);
-         x = xx * cos(the) - zz * sin(the);
-        zz = xx * sin(the) + zz * cos(the);
-        xx =  x * cos(psi) -  y * sin(psi);
-        yy =  x * sin(psi) +  y * cos(psi);
-
-        xx += xo + xd;
-        yy += yo + yd;
-
-        a[i] = 128 + xx * sd / (od - zz);
-        b[i] =  96 + yy * sd / (od - zz);
-    }
+void render_spinny_cube(int xo, int yo, uint16_t the, uint16_t psi, uint16_t phi, bool filled) {
+    static const struct Projection view = { int_to_fixed(128), int_to_fixed(96), int_to_fixed(512), int_to_fixed(256) };
+    struct Vector offset = { int_to_fixed(xo), int_to_fixed(yo), 0 };
+    struct Matrix3 r;
+    struct Matrix4 m;
+    struct Vector v[8];
+    struct Point p[8];
 
-    for(i = 0; i < 6; i++) {
-        x1 = a[shape[i][0]];
-        x2 = a[shape[i][1]];
-        x3 = a[shape[i][2]];
-        x4 = a[shape[i][3]];
-        y1 = b[shape[i][0]];
-        y2 = b[shape[i][1]];
-        y3 = b[shape[i][2]];
-        y4 = b[shape[i][3]];
-
-        if(x1 * (y2 - y3) + x2 * (y3 - y1) + x3 * (y1 - y2) <= 0) {
-            draw_polygon(x1, y1, x2, y2, x3, y3, x4, y4, shape[i][4], filled);
-        }
-    }
-}
+    matrix3_rotate(&r, phi, -the, psi);
+    matrix4_set(&m, &r, &offset);
+    transform_vertices(&m, shape_pts, v, 8);
+    project_vertices(&view, v, p, 8);
 
-// Draw a Mandlebrot
-//
-void render_mandlebrot(void) {
-    int k = 0;
-    float i , j , r , x , y;
-    for(y = 0; y < height; y++) {
-        for(x = 0; x < width; x++) {
-            plot(x, y, col_mandelbrot[k]);
-            for(i = k = r = 0; j = r * r - i * i - 2 + x / 100, i = 2 * r * i + (y - 96) / 70, j * j + i * i < 11 && k++ < 15; r = j);
+    for(int i = 0; i < 6; i++) {
+        struct Point * p1 = &p[shape[i][0]];
+        struct Point * p2 = &p[shape[i][1]];
+        struct Point * p3 = &p[shape[i][2]];
+        struct Point * p4 = &p[shape[i][3]];
+
+        if(face_visible(p1, p2, p3)) {
+            queue_polygon(
+                fixed_to_int(p1->x), fixed_to_int(p1->y), fixed_to_int(p2->x), fixed_to_int(p2->y),
+                fixed_to_int(p3->x), fixed_to_int(p3->y), fixed_to_int(p4->x), fixed_to_int(p4->y),
+                shape[i][4], filled
+            );
         }
     }
 }
@@ -229,10 +279,48 @@ void render_mandlebrot(void) {
 // Simple terminal output from UART
 //
 void demo_terminal(void) {
-    initialise_terminal();  // Initialise the UART
     set_mode(2);
     set_border(col_terminal_border);
     cls(col_terminal_bg);
+    initialise_terminal();  // Initialise the UART
     terminal();             // And do the terminal
     set_mode(0);
+}
+
+// Terminal on core 1 in the bottom of the screen, with core 0 drawing above it
+// The terminal keeps up with the UART however long core 0 takes over each frame
+//
+void demo_terminal_split(void) {
+    int split = 128;        // The terminal gets the rows below this
+    int cx = width / 2;
+    int cy = split / 2;
+    int r = split / 2 - 4;
+    int x[4], y[4];
+    double a = 0;
+    char s[32];
+
+    set_mode(2);
+    set_border(col_terminal_border);
+    cls(col_terminal_bg);
+    start_terminal_core1(split, height - split);
+    terminal_print("Terminal running on core 1\r\n");
+
+    for(int frame = 0; terminal_running; frame++) {
+        wait_vblank();
+        if(frame > 0) {     // Rub out the last square
+            draw_polygon(x[0], y[0], x[1], y[1], x[2], y[2], x[3], y[3], col_terminal_bg, false);
+        }
+        for(int i = 0; i < 4; i++) {
+            x[i] = cx + r * cos(a + i * M_PI / 2);
+            y[i] = cy + r * sin(a + i * M_PI / 2);
+        }
+        draw_polygon(x[0], y[0], x[1], y[1], x[2], y[2], x[3], y[3], col_terminal_fg, false);
+        if(frame % 500 == 0) {
+            snprintf(s, sizeof(s), "Core 0 frame %d\r\n", frame);
+            terminal_print(s);
+        }
+        a += 0.02;
+    }
+    stop_terminal_core1();
+    set_mode(0);
 }
\ No newline at end of file
@@ -2,11 +2,15 @@
 // Title:	        Pico-mposite Video Output
 // Author:	        Dean Belfield
 // Created:	        26/01/2021
-// Last Updated:	01/03/2022
+// Last Updated:	17/10/2026
 //
 // Modinfo:
 // 20/02/2022:      Added demo_terminal
 // 01/03/2022:      Added colour to the demos
+// 17/10/2026:      Added demo_terminal_split
+// 17/10/2026:      render_spinny_cube now takes fixed point angles
+// 17/10/2026:      Added demo_mesh
+// 17/10/2026:      Removed render_mandlebrot; the Mandlebrot is now drawn by mandelbrot.c
 
 #pragma once
 
@@ -32,8 +36,9 @@ int main(void);
 
 void demo_splash(void);
 void demo_spinny_cube(void);
+void demo_mesh(void);
 void demo_mandlebrot(void);
 void demo_terminal(void);
+void demo_terminal_split(void);
 
-void render_spinny_cube(int xo, int yo, double the, double psi, double phi, bool filled);
-void render_mandlebrot(void);
\ No newline at end of file
+void render_spinny_cube(int xo, int yo, uint16_t the, uint16_t psi, uint16_t phi, bool filled);
\ No newline at end of file
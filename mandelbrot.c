@@ -0,0 +1,293 @@
+//
+// Title:	        Pico-mposite Mandelbrot
+// Description:		Draws the Mandelbrot set in fixed point on both cores
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Added periodicity checking, and drawing by subdividing rectangles with a coarse preview first
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#include "cvideo.h"
+#include "graphics.h"
+
+#include "mandelbrot.h"
+
+/*
+ * The iteration is done in 4.28 fixed point, which covers the whole set with a pixel size down to about
+ * 1/10000000, and needs no floating point. Points in the set would otherwise take the full iteration limit,
+ * so the orbit is compared against a saved point, which is moved on at doubling intervals; if the orbit
+ * comes back to it exactly, it is a cycle that will never escape.
+ *
+ * mandelbrot_scan draws every pixel, with each core taking alternate rows. mandelbrot_subdivide avoids most
+ * of the work inside the set and in the outer bands (Mariani-Silver): the screen is split into cells, and if
+ * every pixel on the border of a cell is the same colour, the connectedness of the set means the inside is
+ * too, so it is filled without iterating. Otherwise the cell is cut in two and each half is tried the same
+ * way. The test is done on the colours already drawn in the bitmap, rather than keeping the iteration counts
+ * in a buffer the size of the screen. This is done in three passes, so a picture appears straight away:
+ *
+ * 1. A preview, with one pixel iterated for each 8x8 block
+ * 2. The borders of the 16x16 cells
+ * 3. The inside of each cell
+ *
+ * Each core takes alternate rows of cells; the cores wait for each other after the second pass, as the
+ * bottom border of each cell is drawn by the other core
+ */
+
+#define cell_size           16      // The size of the cells in mandelbrot_subdivide
+#define cell_min            4       // Cells smaller than this are iterated a pixel at a time
+
+static const struct MandelbrotView * mandelbrot_view;  // The view being drawn by both cores
+static volatile bool mandelbrot_core1_busy;
+static volatile int mandelbrot_pass[2];                 // The pass each core has finished
+
+// Iterate a point
+// - cr, ci: The point
+// - iterations: The iteration limit
+// Returns:
+// - The number of iterations before the point escaped, or iterations if it did not
+//
+int mandelbrot_iterate(int32_t cr, int32_t ci, int iterations) {
+    int32_t zr = 0, zi = 0;
+    int32_t pr = 0, pi = 0;                         // The saved point for the periodicity check
+    int period = 8, count = 0;
+
+    for(int n = 0; n < iterations; n++) {
+        int64_t zr2 = (int64_t)zr * zr;             // These are 8.56
+        int64_t zi2 = (int64_t)zi * zi;
+        if(zr2 + zi2 > ((int64_t)4 << 56)) {
+            return n;
+        }
+        zi = (int32_t)(((int64_t)zr * zi) >> 27) + ci;
+        zr = (int32_t)((zr2 - zi2) >> 28) + cr;
+        if(zr == pr && zi == pi) {                  // Back where it was, so in the set
+            return iterations;
+        }
+        if(++count == period) {
+            count = 0;
+            period <<= 1;
+            pr = zr;
+            pi = zi;
+        }
+    }
+    return iterations;
+}
+
+// Get the colour for an iteration count
+//
+static inline unsigned char mandelbrot_colour(const struct MandelbrotView * view, int n) {
+    return n >= view->iterations ? view->colours[0] : view->colours[1 + n % (view->colour_count - 1)];
+}
+
+// Draw every other row of the view
+// - first: The first row
+//
+static void mandelbrot_rows(int first) {
+    const struct MandelbrotView * view = mandelbrot_view;
+    int32_t x0 = view->x - view->step * (width / 2);
+
+    for(int y = first; y < height; y += 2) {
+        unsigned char * row = bitmap_row(y);
+        int32_t ci = view->y + view->step * (y - height / 2);
+        int32_t cr = x0;
+
+        for(int x = 0; x < width; x += 2) {
+            unsigned char c1 = mandelbrot_colour(view, mandelbrot_iterate(cr, ci, view->iterations));
+            unsigned char c2 = mandelbrot_colour(view, mandelbrot_iterate(cr + view->step, ci, view->iterations));
+            #if opt_4bpp == 1
+            row[x >> 1] = c1 | (c2 << 4);
+            #else
+            row[x] = colour_base + c1;
+            row[x + 1] = colour_base + c2;
+            #endif
+            cr += view->step * 2;
+        }
+    }
+}
+
+// Get the colour of a pixel
+// - x, y: The pixel
+//
+static inline unsigned char mandelbrot_pixel(int x, int y) {
+    const struct MandelbrotView * view = mandelbrot_view;
+    int32_t cr = view->x + view->step * (x - width / 2);
+    int32_t ci = view->y + view->step * (y - height / 2);
+    return mandelbrot_colour(view, mandelbrot_iterate(cr, ci, view->iterations));
+}
+
+// Read back a pixel drawn by mandelbrot_pixel
+//
+static inline unsigned char mandelbrot_read(int x, int y) {
+    unsigned char * row = bitmap_row(y);
+    #if opt_4bpp == 1
+    return x & 1 ? row[x >> 1] >> 4 : row[x >> 1] & 0x0F;
+    #else
+    return row[x] - colour_base;
+    #endif
+}
+
+// Draw the inside of a rectangle whose border has been drawn
+// - x1, y1: The top left corner
+// - x2, y2: The bottom right corner
+//
+static void mandelbrot_rectangle(int x1, int y1, int x2, int y2) {
+    unsigned char c = mandelbrot_read(x1, y1);
+    bool uniform = true;
+
+    if(x2 - x1 < 2 || y2 - y1 < 2) {                // Nothing inside
+        return;
+    }
+    for(int x = x1; x <= x2 && uniform; x++) {
+        uniform = mandelbrot_read(x, y1) == c && mandelbrot_read(x, y2) == c;
+    }
+    for(int y = y1 + 1; y < y2 && uniform; y++) {
+        uniform = mandelbrot_read(x1, y) == c && mandelbrot_read(x2, y) == c;
+    }
+    if(uniform) {                                   // Fill it in
+        for(int y = y1 + 1; y < y2; y++) {
+            draw_horizontal_line(y, x1 + 1, x2 - 1, c);
+        }
+    }
+    else if(x2 - x1 < cell_min || y2 - y1 < cell_min) {
+        for(int y = y1 + 1; y < y2; y++) {
+            for(int x = x1 + 1; x < x2; x++) {
+                plot(x, y, mandelbrot_pixel(x, y));
+            }
+        }
+    }
+    else if(x2 - x1 >= y2 - y1) {                   // Else cut it in two across the longest side
+        int xm = (x1 + x2) / 2;
+        for(int y = y1 + 1; y < y2; y++) {
+            plot(xm, y, mandelbrot_pixel(xm, y));
+        }
+        mandelbrot_rectangle(x1, y1, xm, y2);
+        mandelbrot_rectangle(xm, y1, x2, y2);
+    }
+    else {
+        int ym = (y1 + y2) / 2;
+        for(int x = x1 + 1; x < x2; x++) {
+            plot(x, ym, mandelbrot_pixel(x, ym));
+        }
+        mandelbrot_rectangle(x1, y1, x2, ym);
+        mandelbrot_rectangle(x1, ym, x2, y2);
+    }
+}
+
+// Wait until the other core has finished a pass
+// - core: This core
+// - pass: The pass
+//
+static void mandelbrot_wait(int core, int pass) {
+    __mem_fence_release();
+    mandelbrot_pass[core] = pass;
+    while(mandelbrot_pass[core ^ 1] < pass) {
+        tight_loop_contents();
+    }
+    __mem_fence_acquire();
+}
+
+// Draw every other row of cells
+// - first: The first row of cells
+//
+static void mandelbrot_cells(int first) {
+    for(int y = first * cell_size; y < height; y += cell_size * 2) {    // A rough picture first
+        for(int by = y; by < y + cell_size && by < height; by += 8) {
+            for(int x = 0; x < width; x += 8) {
+                unsigned char c = mandelbrot_pixel(x, by);
+                for(int i = by; i < by + 8 && i < height; i++) {
+                    draw_horizontal_line(i, x, x + 7, c);
+                }
+            }
+        }
+    }
+    for(int y = first * cell_size; y < height; y += cell_size * 2) {    // Then the borders of the cells
+        int y2 = y + cell_size < height - 1 ? y + cell_size : height - 1;
+        for(int x = 0; x < width; x++) {
+            plot(x, y, mandelbrot_pixel(x, y));
+        }
+        if(y2 == height - 1) {
+            for(int x = 0; x < width; x++) {
+                plot(x, y2, mandelbrot_pixel(x, y2));
+            }
+        }
+        for(int i = y + 1; i < y2; i++) {
+            for(int x = 0; x < width; x += cell_size) {
+                plot(x, i, mandelbrot_pixel(x, i));
+            }
+            plot(width - 1, i, mandelbrot_pixel(width - 1, i));
+        }
+    }
+    mandelbrot_wait(first, 1);
+    for(int y = first * cell_size; y < height - 1; y += cell_size * 2) {  // Then fill them in
+        int y2 = y + cell_size < height - 1 ? y + cell_size : height - 1;
+        for(int x = 0; x < width - 1; x += cell_size) {
+            mandelbrot_rectangle(x, y, x + cell_size < width - 1 ? x + cell_size : width - 1, y2);
+        }
+    }
+}
+
+static void mandelbrot_core1(void) {
+    if(mandelbrot_view->method == mandelbrot_scan) {
+        mandelbrot_rows(1);
+    }
+    else {
+        mandelbrot_cells(1);
+    }
+    __mem_fence_release();
+    mandelbrot_core1_busy = false;
+}
+
+// Draw the Mandelbrot set
+// This uses core 1 as well, which must not be doing anything else
+// - view: The view
+// Returns:
+// - The time taken in microseconds
+//
+uint32_t draw_mandelbrot(const struct MandelbrotView * view) {
+    uint32_t t = time_us_32();
+
+    mandelbrot_view = view;
+    mandelbrot_core1_busy = true;
+    mandelbrot_pass[0] = 0;
+    mandelbrot_pass[1] = 0;
+    multicore_reset_core1();
+    multicore_launch_core1(mandelbrot_core1);
+    if(view->method == mandelbrot_scan) {
+        mandelbrot_rows(0);
+    }
+    else {
+        mandelbrot_cells(0);
+    }
+    while(mandelbrot_core1_busy) {
+        tight_loop_contents();
+    }
+    __mem_fence_acquire();
+    multicore_reset_core1();
+    return time_us_32() - t;
+}
+
+// Zoom the view in or out
+// - view: The view
+// - x, y: The pixel to centre the view on
+// - zoom: Zoom in by a factor of two this many times; negative to zoom out
+//
+void zoom_mandelbrot(struct MandelbrotView * view, int x, int y, int zoom) {
+    view->x += view->step * (x - width / 2);
+    view->y += view->step * (y - height / 2);
+    if(zoom > 0) {
+        view->step >>= zoom;
+        if(view->step < 1) {
+            view->step = 1;
+        }
+    }
+    else {
+        view->step <<= -zoom;
+    }
+}
@@ -0,0 +1,31 @@
+//
+// Title:	        Pico-mposite Mandelbrot
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Added the drawing method to the view
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define float_to_q28(f)     ((int32_t)((f) * (1 << 28)))    // Coordinates are 4.28 fixed point
+
+#define mandelbrot_subdivide    0   // Drawing methods; fill in areas of the same colour, with a rough picture first
+#define mandelbrot_scan         1   // Or iterate every pixel
+
+struct MandelbrotView {
+    int32_t x, y;                   // The point in the centre of the screen
+    int32_t step;                   // The distance between pixels
+    int iterations;                 // The iteration limit
+    const unsigned char * colours;  // The colour of points in the set, followed by the colours for the iteration counts
+    int colour_count;
+    int method;                     // One of the drawing methods
+};
+
+int mandelbrot_iterate(int32_t cr, int32_t ci, int iterations);
+uint32_t draw_mandelbrot(const struct MandelbrotView * view);
+void zoom_mandelbrot(struct MandelbrotView * view, int x, int y, int zoom);
@@ -0,0 +1,174 @@
+//
+// Title:	        Pico-mposite Meshes
+// Description:		Draws meshes of triangles and quads with back face culling and depth sorting
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+
+#include "pico/stdlib.h"
+
+#include "graphics.h"
+#include "fixed.h"
+
+#include "mesh.h"
+
+/*
+ * Each vertex is transformed and projected once, however many faces share it. Faces pointing away from the
+ * viewer are dropped, and the rest are sorted by depth into buckets and drawn furthest first (the painter's
+ * algorithm), so meshes do not need to be convex. Bucket sorting is a single pass over the faces, with no
+ * comparisons; faces that end up in the same bucket are close enough in depth that the order between them
+ * rarely matters.
+ *
+ * The working buffers are static, so only one core at a time can be drawing a mesh
+ */
+
+static struct Vector mesh_view[mesh_max_vertices];      // The vertices after transforming
+static struct Point mesh_screen[mesh_max_vertices];     // The vertices on screen
+static short mesh_visible[mesh_max_faces];              // The faces facing the viewer
+static fixed mesh_depth[mesh_max_faces];                // The depth of each of those
+static short mesh_next[mesh_max_faces];                 // The next of those in the same bucket
+static short mesh_bucket[mesh_depth_buckets];           // The first of those in each bucket
+
+// Draw a face
+// - p: The corners on screen
+// - f: The face
+// - filled: Set to true for a filled face
+//
+static void draw_face(const struct Point * p, const struct Face * f, bool filled) {
+    const struct Point * a = &p[f->v[0]];
+    const struct Point * b = &p[f->v[1]];
+    const struct Point * c = &p[f->v[2]];
+
+    if(filled) {
+        draw_triangle_fixed(a->x, a->y, b->x, b->y, c->x, c->y, f->c);
+        if(f->n == 4) {
+            const struct Point * d = &p[f->v[3]];
+            draw_triangle_fixed(a->x, a->y, c->x, c->y, d->x, d->y, f->c);
+        }
+    }
+    else {
+        for(int i = 0; i < f->n; i++) {
+            a = &p[f->v[i]];
+            b = &p[f->v[i + 1 < f->n ? i + 1 : 0]];
+            draw_line(fixed_to_int(a->x), fixed_to_int(a->y), fixed_to_int(b->x), fixed_to_int(b->y), f->c);
+        }
+    }
+}
+
+// Draw a mesh
+// Faces with a corner closer than one unit from the viewer are not drawn
+// - mesh: The mesh
+// - m: The matrix that places the mesh in view
+// - p: The projection
+// - filled: Set to true for filled faces
+// Returns:
+// - The number of faces drawn, or -1 if the mesh is too big
+//
+int render_mesh(const struct Mesh * mesh, const struct Matrix4 * m, const struct Projection * p, bool filled) {
+    int visible = 0;
+    fixed near = p->distance - fixed_one;
+    fixed z_min = INT32_MAX;
+    fixed z_max = INT32_MIN;
+
+    if(mesh->vertex_count > mesh_max_vertices || mesh->face_count > mesh_max_faces) {
+        return -1;
+    }
+    transform_vertices(m, mesh->vertices, mesh_view, mesh->vertex_count);
+    project_vertices(p, mesh_view, mesh_screen, mesh->vertex_count);
+
+    for(int i = 0; i < mesh->face_count; i++) {     // Work out the depth of the faces facing the viewer
+        const struct Face * f = &mesh->faces[i];
+        int64_t z = 0;
+        if(!face_visible(&mesh_screen[f->v[0]], &mesh_screen[f->v[1]], &mesh_screen[f->v[2]])) {
+            continue;
+        }
+        int j;
+        for(j = 0; j < f->n; j++) {
+            fixed v = mesh_view[f->v[j]].z;
+            if(v > near) {                          // Too close, or behind the viewer
+                break;
+            }
+            z += v;
+        }
+        if(j < f->n) {
+            continue;
+        }
+        fixed depth = f->n == 4 ? (fixed)(z >> 2) : (fixed)((z * 21845) >> 16);
+        if(depth < z_min) {
+            z_min = depth;
+        }
+        if(depth > z_max) {
+            z_max = depth;
+        }
+        mesh_visible[visible] = i;
+        mesh_depth[visible] = depth;
+        visible++;
+    }
+    if(visible == 0) {
+        return 0;
+    }
+
+    int shift = 0;                                  // Scale the depths to the number of buckets
+    while(((uint32_t)z_max - (uint32_t)z_min) >> shift >= mesh_depth_buckets) {
+        shift++;
+    }
+    for(int i = 0; i < mesh_depth_buckets; i++) {
+        mesh_bucket[i] = -1;
+    }
+    for(int i = 0; i < visible; i++) {
+        int b = ((uint32_t)mesh_depth[i] - (uint32_t)z_min) >> shift;
+        mesh_next[i] = mesh_bucket[b];
+        mesh_bucket[b] = i;
+    }
+    for(int b = 0; b < mesh_depth_buckets; b++) {   // Then draw them, furthest away first
+        for(int i = mesh_bucket[b]; i >= 0; i = mesh_next[i]) {
+            draw_face(mesh_screen, &mesh->faces[mesh_visible[i]], filled);
+        }
+    }
+    return visible;
+}
+
+// Build a torus around the z axis
+// - mesh: The mesh to set up
+// - vertices: Buffer for rings * sides vertices
+// - faces: Buffer for rings * sides faces
+// - rings: Number of segments around the z axis
+// - sides: Number of segments around the tube
+// - r1: Distance from the centre to the middle of the tube
+// - r2: Radius of the tube
+// - colours: The face colours, used in turn
+// - colour_count: Number of colours
+// Returns:
+// - The number of faces
+//
+int mesh_torus(struct Mesh * mesh, struct Vector * vertices, struct Face * faces, int rings, int sides, fixed r1, fixed r2, const unsigned char * colours, int colour_count) {
+    for(int i = 0; i < rings; i++) {
+        uint16_t u = i * angle_full / rings;
+        for(int j = 0; j < sides; j++) {
+            uint16_t v = j * angle_full / sides;
+            fixed r = r1 + fixed_mul(r2, fixed_cos(v));
+            struct Vector * p = &vertices[i * sides + j];
+            struct Face * f = &faces[i * sides + j];
+            int i1 = (i + 1) % rings;
+            int j1 = (j + 1) % sides;
+
+            p->x = fixed_mul(r, fixed_cos(u));
+            p->y = fixed_mul(r, fixed_sin(u));
+            p->z = fixed_mul(r2, fixed_sin(v));
+            f->v[0] = i * sides + j;
+            f->v[1] = i * sides + j1;
+            f->v[2] = i1 * sides + j1;
+            f->v[3] = i1 * sides + j;
+            f->n = 4;
+            f->c = colours[(i + j) % colour_count];
+        }
+    }
+    mesh->vertices = vertices;
+    mesh->faces = faces;
+    mesh->vertex_count = rings * sides;
+    mesh->face_count = rings * sides;
+    return mesh->face_count;
+}
@@ -0,0 +1,35 @@
+//
+// Title:	        Pico-mposite Meshes
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fixed.h"
+
+#define mesh_max_vertices   512     // Largest mesh that render_mesh can draw
+#define mesh_max_faces      1024
+#define mesh_depth_buckets  256     // Number of buckets the faces are sorted into; must be a power of two
+
+struct Face {                       // A triangle or a quad
+    unsigned short v[4];            // Indexes of the corners, anticlockwise when facing the viewer
+    unsigned char n;                // Number of corners, 3 or 4
+    unsigned char c;                // Colour
+};
+
+struct Mesh {
+    const struct Vector * vertices;
+    const struct Face * faces;
+    int vertex_count;
+    int face_count;
+};
+
+int render_mesh(const struct Mesh * mesh, const struct Matrix4 * m, const struct Projection * p, bool filled);
+int mesh_torus(struct Mesh * mesh, struct Vector * vertices, struct Face * faces, int rings, int sides, fixed r1, fixed r2, const unsigned char * colours, int colour_count);
@@ -0,0 +1,116 @@
+//
+// Title:	        Pico-mposite Ring Buffer
+// Description:		Lock-free single producer, single consumer ring buffer
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+// The producer only ever writes head and the consumer only ever writes tail, so one side can be an interrupt
+// handler or the other core without any locking. The size must be a power of two; head and tail run freely
+// and are masked when the buffer is indexed, so a full buffer can be told apart from an empty one
+//
+
+#pragma once
+
+#include "pico/stdlib.h"
+
+struct Ring {
+    unsigned char * buffer;
+    uint32_t mask;                  // Size of the buffer - 1
+    volatile uint32_t head;         // Next byte to write; only changed by the producer
+    volatile uint32_t tail;         // Next byte to read; only changed by the consumer
+};
+
+// Initialise a ring buffer
+// - ring: The ring buffer
+// - buffer: Memory for the data
+// - size: Size of the buffer in bytes; must be a power of two
+//
+static inline void ring_init(struct Ring * ring, void * buffer, uint32_t size) {
+    ring->buffer = buffer;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+// Get the number of bytes waiting to be read
+//
+static inline uint32_t ring_count(struct Ring * ring) {
+    return ring->head - ring->tail;
+}
+
+// Get the number of bytes that can be written
+//
+static inline uint32_t ring_space(struct Ring * ring) {
+    return ring->mask + 1 - ring_count(ring);
+}
+
+// Write a byte (producer only)
+// Returns:
+// - false if the buffer is full
+//
+static inline bool ring_put(struct Ring * ring, unsigned char c) {
+    uint32_t head = ring->head;
+    if(head - ring->tail > ring->mask) {
+        return false;
+    }
+    ring->buffer[head & ring->mask] = c;
+    __mem_fence_release();                  // The data must land before the consumer sees the new head
+    ring->head = head + 1;
+    return true;
+}
+
+// Write a block of bytes (producer only)
+// The block is written in full or not at all, so it can be used for fixed size records
+// - data: The data to write
+// - n: Number of bytes
+// Returns:
+// - false if there is not enough space
+//
+static inline bool ring_write(struct Ring * ring, const void * data, uint32_t n) {
+    uint32_t head = ring->head;
+    if(ring->mask + 1 - (head - ring->tail) < n) {
+        return false;
+    }
+    uint32_t i = head & ring->mask;
+    uint32_t first = ring->mask + 1 - i;    // Bytes before the end of the buffer
+    if(first >= n) {
+        memcpy(&ring->buffer[i], data, n);
+    }
+    else {
+        memcpy(&ring->buffer[i], data, first);
+        memcpy(ring->buffer, (const unsigned char *)data + first, n - first);
+    }
+    __mem_fence_release();
+    ring->head = head + n;
+    return true;
+}
+
+// Read up to n bytes (consumer only)
+// - data: Buffer for the data
+// - n: Maximum number of bytes to read
+// Returns:
+// - The number of bytes read
+//
+static inline uint32_t ring_read(struct Ring * ring, void * data, uint32_t n) {
+    uint32_t tail = ring->tail;
+    uint32_t count = ring->head - tail;
+    __mem_fence_acquire();                  // Read head before the data it covers
+    if(n > count) {
+        n = count;
+    }
+    uint32_t i = tail & ring->mask;
+    uint32_t first = ring->mask + 1 - i;
+    if(first >= n) {
+        memcpy(data, &ring->buffer[i], n);
+    }
+    else {
+        memcpy(data, &ring->buffer[i], first);
+        memcpy((unsigned char *)data + first, ring->buffer, n - first);
+    }
+    __mem_fence_release();                  // Finish with the data before the producer can reuse it
+    ring->tail = tail + n;
+    return n;
+}
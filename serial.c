@@ -0,0 +1,88 @@
+//
+// Title:	        Pico-mposite Serial Input
+// Description:		Interrupt driven UART receive into a ring buffer
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+
+#include "pico/stdlib.h"
+
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+
+#include "ring.h"
+#include "serial.h"
+
+/*
+ * The UART only has a 32 byte receive FIFO, which fills in 350us at 921600 baud, so anything that holds
+ * up the reader for longer than that loses data. Instead the receive interrupt empties the FIFO into a
+ * much larger ring buffer, and the reader drains that in batches whenever it is ready
+ */
+
+static unsigned char serial_buffer[opt_serial_buffer_size];
+static struct Ring serial_ring;
+
+volatile struct SerialStats serial_stats;
+
+// Initialise the UART and start receiving
+// - baud: The baud rate
+//
+void initialise_serial(uint baud) {
+    ring_init(&serial_ring, serial_buffer, sizeof(serial_buffer));
+    memset((void *)&serial_stats, 0, sizeof(serial_stats));
+
+    uart_init(serial_uart, baud);
+    gpio_set_function(serial_pin_tx, GPIO_FUNC_UART);
+    gpio_set_function(serial_pin_rx, GPIO_FUNC_UART);
+
+    irq_set_exclusive_handler(UART0_IRQ, serial_irq_handler);
+    irq_set_priority(UART0_IRQ, PICO_DEFAULT_IRQ_PRIORITY + 0x40);  // Below the video interrupt
+    irq_set_enabled(UART0_IRQ, true);
+    uart_set_irq_enables(serial_uart, true, false);     // Interrupt on the FIFO level and on receive timeout
+    hw_write_masked(                                    // And make that level half full
+        &uart_get_hw(serial_uart)->ifls,
+        2 << UART_UARTIFLS_RXIFLSEL_LSB,
+        UART_UARTIFLS_RXIFLSEL_BITS
+    );
+}
+
+// Get the number of bytes waiting to be read
+//
+uint32_t serial_available(void) {
+    return ring_count(&serial_ring);
+}
+
+// Read any bytes received
+// - buffer: Buffer for the data
+// - size: Size of the buffer
+// Returns:
+// - Number of bytes read; 0 if there are none waiting
+//
+uint32_t serial_read(unsigned char * buffer, uint32_t size) {
+    return ring_read(&serial_ring, buffer, size);
+}
+
+// The UART receive interrupt handler
+// Empties the FIFO into the ring buffer
+//
+void serial_irq_handler(void) {
+    uart_hw_t * hw = uart_get_hw(serial_uart);
+
+    while(uart_is_readable(serial_uart)) {
+        uint32_t data = hw->dr;                 // Each byte comes with its own error flags
+        if(data & UART_UARTDR_OE_BITS) {        // The FIFO overflowed before this byte
+            serial_stats.overrun++;
+        }
+        if(data & (UART_UARTDR_FE_BITS | UART_UARTDR_PE_BITS | UART_UARTDR_BE_BITS)) {
+            serial_stats.errors++;
+            continue;
+        }
+        serial_stats.received++;
+        if(!ring_put(&serial_ring, data)) {
+            serial_stats.overflow++;
+        }
+    }
+}
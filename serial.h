@@ -0,0 +1,31 @@
+//
+// Title:	        Pico-mposite Serial Input
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+
+#pragma once
+
+#include "config.h"
+
+#define serial_uart         uart0   // The UART on pins 12 and 13
+#define serial_pin_tx       12
+#define serial_pin_rx       13
+
+struct SerialStats {
+    uint32_t received;              // Bytes received
+    uint32_t overflow;              // Bytes dropped because the ring buffer was full
+    uint32_t overrun;               // Times the UART FIFO overflowed before the interrupt handler emptied it
+    uint32_t errors;                // Bytes dropped with a framing, parity or break error
+};
+
+extern volatile struct SerialStats serial_stats;
+
+void initialise_serial(uint baud);
+uint32_t serial_available(void);
+uint32_t serial_read(unsigned char * buffer, uint32_t size);
+
+void serial_irq_handler(void);
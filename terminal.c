@@ -3,86 +3,938 @@
 // Description:		Simple terminal emulation
 // Author:	        Dean Belfield
 // Created:	        19/02/2022
-// Last Updated:	03/03/2022
+// Last Updated:	17/10/2026
 //
 // Modinfo:
 // 03/03/2022:      Added colour
+// 17/10/2026:      Input is now read from the serial ring buffer and rendered in batches
+// 17/10/2026:      Added terminal windows, and running the terminal on core 1
+// 17/10/2026:      Text is now kept in character cells and only damaged cells are drawn, once a frame
+// 17/10/2026:      Added a parser for the common ANSI escape sequences
+// 17/10/2026:      The terminal loop sleeps between serial interrupts and vblanks
+// 17/10/2026:      stop_terminal_core1 asks core 1 to stop and waits for it before resetting the core
+// 17/10/2026:      Added the extended SGR colours, mapped to the nearest of the 16 ANSI colours
+// 17/10/2026:      Cells are drawn with the foreground colour in the glyph and the background colour behind it
 
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
 
 #include "hardware/pio.h"
 #include "hardware/dma.h"
 #include "hardware/irq.h"  
-#include "hardware/uart.h" 
 
 #include "cvideo.h"
 #include "graphics.h"
+#include "ring.h"
+#include "serial.h"
 
 #include "terminal.h"
 
-int terminal_x;
+/*
+ * The terminal keeps the text in an array of character cells, each with its own colours, and only draws
+ * to the bitmap in terminal_render. Writing text just updates the cells and marks them as damaged, so
+ * terminal_render, which is called at most once a frame, only redraws cells that have changed since the
+ * last frame, however many times they were written. The window is scrolled by rotating its lines in the
+ * display list, so a scroll is a matter of blanking one row of cells; the row is cleared with a fill at the
+ * next render. As the text is kept, it can be redrawn in full after a change of mode with terminal_redraw.
+ *
+ * The cells are stored by position in the window in the bitmap, rather than position on screen, so they
+ * scroll round with the pixels. When the terminal is run on core 1, core 0 is free to draw in the rest of
+ * the screen, and can send text to the terminal through terminal_queue
+ *
+ * Escape sequences are parsed a byte at a time by a state machine in terminal_put, covering the common VT100
+ * and ANSI sequences; cursor movement, erasing, scroll regions, inserting and deleting lines, and the SGR
+ * colours, which are mapped onto the grey levels or RGB332 palette. Erasing a whole row blanks it for a fill
+ * at the next render, and erasing part of a row fills the pixels there and then, rather than drawing spaces.
+ * Scrolling the whole window rotates the display list as before, in either direction; scrolling a region
+ * copies the pixel rows of each text row with the cells
+ */
+
+int terminal_x;                 // Cursor position in the window, in characters
 int terminal_y;
+int terminal_cols;              // The size of the window in characters
+int terminal_rows;
+int terminal_top;               // The top pixel row of the window on screen
+int terminal_height;            // The height of the window in pixel rows
+int terminal_scroll;            // The window row shown at the top of the window
+unsigned char terminal_fc;      // The colours for new text
+unsigned char terminal_bc;
+
+static struct Cell terminal_cells[terminal_max_rows][terminal_max_cols];    // Rows in bitmap order
+static unsigned char terminal_damage_first[terminal_max_rows];  // The range of damaged cells in each row
+static unsigned char terminal_damage_last[terminal_max_rows];
+static bool terminal_row_cleared[terminal_max_rows];            // Set if the whole row needs clearing first
+static bool terminal_damaged;                                   // Set if anything needs drawing
+static int terminal_shown_scroll;                               // The scroll in the display list
+static int terminal_cursor_row;                                 // Where the cursor was drawn, or -1
+static int terminal_cursor_col;
+static bool terminal_cursor_visible;
+
+#define state_normal        0       // Escape sequence parser states
+#define state_escape        1       // After ESC
+#define state_csi           2       // After ESC [
+#define state_charset       3       // After ESC ( or ESC )
+
+#define csi_max_params      8
+
+struct SGR {                        // Text attributes
+    signed char fg, bg;             // Index in terminal_palette, or -1 for the default colour
+    bool bold;
+    bool reverse;
+};
+
+struct SavedCursor {
+    int x, y;
+    struct SGR sgr;
+};
+
+static int terminal_state;
+static int terminal_params[csi_max_params];
+static int terminal_param_count;
+static bool terminal_private;                                   // Set for ESC [ ? sequences
+static int terminal_region_top;                                 // The scroll region, as rows in the window
+static int terminal_region_bottom;
+static struct SGR terminal_sgr;
+static struct SavedCursor terminal_saved;
+
+// The ANSI colours; black, red, green, yellow, blue, magenta, cyan and white, then the bright versions
+//
+#if opt_colour == 0
+static const unsigned char terminal_palette[16] = {     // Grey levels by brightness
+    0, 3, 6, 9, 1, 4, 7, 10, 5, 8, 11, 14, 6, 9, 12, 15,
+};
+#else
+static const unsigned char terminal_palette[16] = {
+    rgb(0,0,0), rgb(5,0,0), rgb(0,5,0), rgb(5,5,0), rgb(0,0,4), rgb(5,0,4), rgb(0,5,4), rgb(5,5,4),
+    rgb(2,2,2), rgb(7,2,2), rgb(2,7,2), rgb(7,7,2), rgb(2,2,7), rgb(7,2,7), rgb(2,7,7), rgb(7,7,7),
+};
+#endif
+
+static unsigned char terminal_queue_buffer[terminal_queue_size];
+static struct Ring terminal_queue;          // Text sent from core 0 when the terminal is on core 1
+volatile bool terminal_running;             // Cleared by core 1 when the terminal quits
+static volatile bool terminal_stop;         // Set by core 0 to ask the terminal to quit
 
 void initialise_terminal(void) {
-    uart_init(uart0, 115200);
-    gpio_set_function(12, GPIO_FUNC_UART);  // TX
-    gpio_set_function(13, GPIO_FUNC_UART);  // RX
+    initialise_serial(opt_terminal_baud);
+    ring_init(&terminal_queue, terminal_queue_buffer, sizeof(terminal_queue_buffer));
+    set_terminal_window(0, height);
 }
 
-// Handle carriage returns
+// Mark a range of cells for drawing
+// - p: The row of cells in bitmap order
+// - x1, x2: The first and last cell
 //
-void cr(void) {
+static void terminal_damage(int p, int x1, int x2) {
+    if(terminal_damage_first[p] > x1) {
+        terminal_damage_first[p] = x1;
+    }
+    if(terminal_damage_last[p] < x2) {
+        terminal_damage_last[p] = x2;
+    }
+    terminal_damaged = true;
+}
+
+// Blank a row of cells in the current colours, to be cleared at the next render
+// - p: The row of cells in bitmap order
+//
+static void terminal_blank_row(int p) {
+    for(int i = 0; i < terminal_max_cols; i++) {
+        terminal_cells[p][i] = (struct Cell){ ' ', terminal_fc, terminal_bc };
+    }
+    terminal_row_cleared[p] = true;
+    terminal_damage_first[p] = terminal_max_cols;   // The clear covers everything else in the row
+    terminal_damage_last[p] = 0;
+    terminal_damaged = true;
+}
+
+// Get the row of cells in bitmap order for a row in the window
+// - y: The row in the window, in characters
+//
+static inline int terminal_cell_row(int y) {
+    y += terminal_scroll / 8;
+    return y >= terminal_rows ? y - terminal_rows : y;
+}
+
+// Hide the cursor before rows are moved, by marking the cell it was drawn in for redrawing
+//
+static void terminal_hide_cursor(void) {
+    if(terminal_cursor_row >= 0) {
+        terminal_damage(terminal_cursor_row, terminal_cursor_col, terminal_cursor_col);
+        terminal_cursor_row = -1;
+    }
+}
+
+// Set the area of the screen that the terminal draws in
+// This clears the window and resets the hardware scroll
+// - top: The top pixel row of the window
+// - rows: The height of the window in pixel rows; rounded down to whole text rows
+//
+void set_terminal_window(int top, int rows) {
+    terminal_top = top;
+    terminal_cols = width / 8 < terminal_max_cols ? width / 8 : terminal_max_cols;
+    terminal_rows = rows / 8 < terminal_max_rows ? rows / 8 : terminal_max_rows;
+    terminal_height = terminal_rows * 8;
+    terminal_scroll = 0;
     terminal_x = 0;
-    terminal_y += 8;
-    if(terminal_y >= height) {
-        terminal_y -= 8;
-        scroll_up(15, 8);
+    terminal_y = 0;
+    terminal_region_top = 0;
+    terminal_region_bottom = terminal_rows - 1;
+    terminal_cursor_visible = true;
+    terminal_state = state_normal;
+    terminal_sgr = (struct SGR){ .fg = -1, .bg = -1 };
+    terminal_saved = (struct SavedCursor){ .sgr = terminal_sgr };
+    terminal_fc = col_terminal_fg;
+    terminal_bc = col_terminal_bg;
+    set_scroll(0);                          // So the window is in consecutive rows of the bitmap
+    for(int i = 0; i < terminal_height; i++) {
+        draw_horizontal_line(terminal_top + i, 0, width - 1, col_terminal_bg);
     }
+    for(int p = 0; p < terminal_rows; p++) {
+        terminal_blank_row(p);
+        terminal_row_cleared[p] = false;    // Already cleared
+    }
+    terminal_damaged = false;
+    terminal_shown_scroll = 0;
+    terminal_cursor_row = -1;
+}
+
+// Redraw the whole window
+// Call this after set_mode; the window is fitted to the new mode, and scrolled back to the top of the bitmap
+//
+void terminal_redraw(void) {
+    int rows = (height - terminal_top) / 8;
+    int p = terminal_scroll / 8;
+    struct Cell t[terminal_max_cols];
+
+    for(int i = 0; i < p; i++) {            // Rotate the cells back into screen order, a row at a time
+        memcpy(t, terminal_cells[0], sizeof(t));
+        memmove(terminal_cells[0], terminal_cells[1], sizeof(t) * (terminal_rows - 1));
+        memcpy(terminal_cells[terminal_rows - 1], t, sizeof(t));
+    }
+    if(rows < terminal_rows) {              // Drop rows off the top if the window no longer fits
+        int n = terminal_rows - (rows > 0 ? rows : 0);
+        memmove(terminal_cells[0], terminal_cells[n], sizeof(t) * (terminal_rows - n));
+        terminal_rows -= n;
+        terminal_y = terminal_y > n ? terminal_y - n : 0;
+    }
+    terminal_cols = width / 8 < terminal_max_cols ? width / 8 : terminal_max_cols;
+    terminal_height = terminal_rows * 8;
+    terminal_scroll = 0;
+    if(terminal_x >= terminal_cols) {
+        terminal_x = terminal_cols - 1;
+    }
+    terminal_region_top = 0;                // And the scroll region goes back to the whole window
+    terminal_region_bottom = terminal_rows - 1;
+    for(int i = 0; i < terminal_rows; i++) {
+        terminal_row_cleared[i] = true;
+        terminal_damage_first[i] = terminal_max_cols;
+        terminal_damage_last[i] = 0;
+    }
+    terminal_damaged = true;
+    terminal_shown_scroll = -1;             // set_mode has reset the display list
+    terminal_cursor_row = -1;
 }
 
-// Advance one character position
+// Get the row on screen for a row in the terminal window
+// - y: The row in the window
+// Returns:
+// - The row on screen
 //
-void fs(void) {
-    terminal_x += 8;
-    if(terminal_x >= width) {
-        cr();
+int terminal_row(int y) {
+    y += terminal_scroll;
+    if(y >= terminal_height) {
+        y -= terminal_height;
     }
+    return terminal_top + y;
+}
+
+// Scroll the terminal window up by one text row
+// The text row that comes round to the bottom is blanked, and the scroll is shown at the next render
+//
+void terminal_scroll_up(void) {
+    terminal_scroll += 8;
+    if(terminal_scroll >= terminal_height) {
+        terminal_scroll = 0;
+    }
+    terminal_blank_row(terminal_cell_row(terminal_rows - 1));
+}
+
+// Draw everything that has changed since the last render
+//
+void terminal_render(void) {
+    int cursor_col = terminal_x < terminal_cols ? terminal_x : terminal_cols - 1;  // The cursor sits in the last column while a wrap is pending
+    int cursor_row = terminal_cursor_visible ? terminal_cell_row(terminal_y) : -1;
+
+    if(!terminal_damaged && terminal_cursor_row == cursor_row && (cursor_row < 0 || terminal_cursor_col == cursor_col)) {
+        return;
+    }
+    terminal_hide_cursor();                 // Rub out the cursor
+    for(int p = 0; p < terminal_rows; p++) {
+        int y = terminal_top + p * 8;
+        struct Cell * row = terminal_cells[p];
+        if(terminal_row_cleared[p]) {       // Clear the row, then draw whatever is not blank
+            unsigned char bc = row[0].bc;
+            for(int i = 0; i < 8; i++) {
+                draw_horizontal_line(y + i, 0, width - 1, bc);
+            }
+            for(int x = 0; x < terminal_cols; x++) {
+                if(row[x].c != ' ' || row[x].bc != bc) {
+                    print_char(x * 8, y, row[x].c, row[x].bc, row[x].fc);
+                }
+            }
+            terminal_row_cleared[p] = false;
+        }
+        else {
+            int last = terminal_damage_last[p] < terminal_cols ? terminal_damage_last[p] : terminal_cols - 1;
+            for(int x = terminal_damage_first[p]; x <= last; x++) {
+                print_char(x * 8, y, row[x].c, row[x].bc, row[x].fc);
+            }
+        }
+        terminal_damage_first[p] = terminal_max_cols;
+        terminal_damage_last[p] = 0;
+    }
+    if(cursor_row >= 0) {                   // Draw the cursor
+        terminal_cursor_row = cursor_row;
+        terminal_cursor_col = cursor_col;
+        print_char(cursor_col * 8, terminal_top + cursor_row * 8, '_', terminal_cells[cursor_row][cursor_col].bc, col_terminal_cursor);
+    }
+    if(terminal_shown_scroll != terminal_scroll) {  // And show the scroll
+        int repeat = display_lines / height;
+        set_display_lines(terminal_top * repeat, terminal_height * repeat, bitmap_row(terminal_top), terminal_scroll, terminal_height, repeat);
+        commit_display_list(false);
+        terminal_shown_scroll = terminal_scroll;
+    }
+    terminal_damaged = false;
+}
+
+// Copy a row of the window to another, pixels and all
+// - to, from: The rows in the window
+//
+static void terminal_copy_row(int to, int from) {
+    int pt = terminal_cell_row(to);
+    int pf = terminal_cell_row(from);
+
+    memcpy(terminal_cells[pt], terminal_cells[pf], sizeof(terminal_cells[0]));
+    terminal_row_cleared[pt] = terminal_row_cleared[pf];
+    terminal_damage_first[pt] = terminal_damage_first[pf];
+    terminal_damage_last[pt] = terminal_damage_last[pf];
+    if(!terminal_row_cleared[pf]) {         // The pixels are about to be cleared anyway if this is set
+        for(int i = 0; i < 8; i++) {
+            memcpy(bitmap_row(terminal_top + pt * 8 + i), bitmap_row(terminal_top + pf * 8 + i), stride);
+        }
+    }
+}
+
+// Scroll the terminal window down by one text row
+//
+void terminal_scroll_down(void) {
+    terminal_scroll -= 8;
+    if(terminal_scroll < 0) {
+        terminal_scroll = terminal_height - 8;
+    }
+    terminal_blank_row(terminal_cell_row(0));
+}
+
+// Scroll a range of rows in the window
+// The whole window is scrolled in the display list; anything less is copied in the bitmap
+// - top, bottom: The first and last rows
+// - n: Number of rows to scroll up by; negative to scroll down
+//
+static void terminal_move_rows(int top, int bottom, int n) {
+    int count = bottom - top + 1;
+
+    if(n > count) {
+        n = count;
+    }
+    if(n < -count) {
+        n = -count;
+    }
+    if(top == 0 && bottom == terminal_rows - 1) {
+        for(int i = 0; i < n; i++) {
+            terminal_scroll_up();
+        }
+        for(int i = 0; i > n; i--) {
+            terminal_scroll_down();
+        }
+        return;
+    }
+    terminal_hide_cursor();
+    if(n > 0) {
+        for(int y = top; y <= bottom - n; y++) {
+            terminal_copy_row(y, y + n);
+        }
+        for(int y = bottom - n + 1; y <= bottom; y++) {
+            terminal_blank_row(terminal_cell_row(y));
+        }
+    }
+    else if(n < 0) {
+        for(int y = bottom; y >= top - n; y--) {
+            terminal_copy_row(y, y + n);
+        }
+        for(int y = top; y < top - n; y++) {
+            terminal_blank_row(terminal_cell_row(y));
+        }
+    }
+}
+
+// Erase part of a row of the window in the current colours
+// A whole row is cleared at the next render; part of a row is filled straight away
+// - y: The row in the window
+// - x1, x2: The first and last cell
+//
+static void terminal_erase(int y, int x1, int x2) {
+    int p = terminal_cell_row(y);
+
+    if(x2 >= terminal_cols - 1) {
+        x2 = terminal_max_cols - 1;         // Including any cells off the edge in this mode
+    }
+    if(x1 > x2) {
+        return;
+    }
+    if(x1 == 0 && x2 == terminal_max_cols - 1) {
+        terminal_blank_row(p);
+        return;
+    }
+    if(terminal_cursor_row == p && terminal_cursor_col >= x1 && terminal_cursor_col <= x2) {
+        terminal_hide_cursor();             // The fill rubs out the cursor, so it must be drawn again at the next render
+    }
+    for(int x = x1; x <= x2; x++) {
+        terminal_cells[p][x] = (struct Cell){ ' ', terminal_fc, terminal_bc };
+    }
+    if(!terminal_row_cleared[p]) {
+        int x3 = x2 * 8 + 7 < width ? x2 * 8 + 7 : width - 1;
+        for(int i = 0; i < 8; i++) {
+            draw_horizontal_line(terminal_top + p * 8 + i, x1 * 8, x3, terminal_bc);
+        }
+    }
+}
+
+// Line feed; scrolls if the cursor is on the bottom of the scroll region
+//
+void lf(void) {
+    if(terminal_y == terminal_region_bottom) {
+        terminal_move_rows(terminal_region_top, terminal_region_bottom, 1);
+    }
+    else if(terminal_y < terminal_rows - 1) {
+        terminal_y++;
+    }
+}
+
+// Reverse line feed; scrolls if the cursor is on the top of the scroll region
+//
+void ri(void) {
+    if(terminal_y == terminal_region_top) {
+        terminal_move_rows(terminal_region_top, terminal_region_bottom, -1);
+    }
+    else if(terminal_y > 0) {
+        terminal_y--;
+    }
+}
+
+// Carriage return
+//
+void cr(void) {
+    terminal_x = 0;
 }
 
 // Backspace
 //
 void bs(void) {
-    terminal_x -= 8;
-    if(terminal_x < 0) {
-        terminal_x = 0;
+    if(terminal_x >= terminal_cols) {
+        terminal_x = terminal_cols - 1;
+    }
+    if(terminal_x > 0) {
+        terminal_x--;
     }
 }
 
-// The terminal loop
+// Move the cursor, keeping it in the window
+// - x, y: The new position
 //
-void terminal(void) {
+static void terminal_goto(int x, int y) {
+    terminal_x = x < 0 ? 0 : x >= terminal_cols ? terminal_cols - 1 : x;
+    terminal_y = y < 0 ? 0 : y >= terminal_rows ? terminal_rows - 1 : y;
+}
+
+// Work out the colours for new text from the SGR attributes
+//
+static void terminal_set_colours(void) {
+    unsigned char fc = col_terminal_fg;
+    unsigned char bc = col_terminal_bg;
+
+    if(terminal_sgr.fg >= 0) {
+        fc = terminal_palette[terminal_sgr.fg + (terminal_sgr.bold && terminal_sgr.fg < 8 ? 8 : 0)];
+    }
+    if(terminal_sgr.bg >= 0) {
+        bc = terminal_palette[terminal_sgr.bg];
+    }
+    terminal_fc = terminal_sgr.reverse ? bc : fc;
+    terminal_bc = terminal_sgr.reverse ? fc : bc;
+}
+
+// Reset the terminal, clearing the window
+//
+static void terminal_reset(void) {
+    terminal_sgr = (struct SGR){ .fg = -1, .bg = -1 };
+    terminal_set_colours();
+    terminal_saved = (struct SavedCursor){ .sgr = terminal_sgr };
+    terminal_region_top = 0;
+    terminal_region_bottom = terminal_rows - 1;
+    terminal_cursor_visible = true;
+    terminal_state = state_normal;
     terminal_x = 0;
     terminal_y = 0;
-    while(true) {
-        print_char(terminal_x, terminal_y, '_', col_terminal_cursor, col_terminal_bg);
-        char c = uart_getc(uart0);          // Get the character from the UART (blocking)
-        if(c >= 32) {                       // Output printable characters
-            print_char(terminal_x, terminal_y, c, col_terminal_fg, col_terminal_bg);
-            fs();
-        }
-        else {                              // Else deal with the important control characters
-            print_char(terminal_x, terminal_y, ' ', col_terminal_fg, col_terminal_bg);  
-            switch(c) {
-                case 0x08:  // Backspace
-                    bs();
-                    break;
-                case 0x0D:  // CR
-                    cr();
-                    break;
-                case 0x03:  // Ctrl+C       // Quit the terminal loop on these codes
-                case 0x1B:  // ESC
-                    return;
-            }
-        }
-    }
-}
\ No newline at end of file
+    for(int y = 0; y < terminal_rows; y++) {
+        terminal_blank_row(y);
+    }
+}
+
+// Get the nearest of the 16 ANSI colours to an RGB colour
+// - r, g, b: The colour, 0 to 255 for each component
+//
+static int terminal_nearest_colour(int r, int g, int b) {
+    int max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+    int c = (r > 127) | (g > 127) << 1 | (b > 127) << 2;
+
+    if(c == 0) {
+        return max > 63 ? 8 : 0;            // Black, or dark grey
+    }
+    return max > 191 ? c + 8 : c;           // The bright colours are the brightest
+}
+
+// Read the parameters of an extended colour, 38 or 48 followed by 5;n for one of 256 colours, or 2;r;g;b
+// - i: The index of the 38 or 48; moved on past the parameters that have been used
+// Returns:
+// - The nearest of the 16 ANSI colours, or -1 if the parameters are not valid
+//
+static int terminal_sgr_extended(int * i) {
+    int * p = &terminal_params[*i + 1];
+    int left = terminal_param_count - *i - 1;
+
+    if(left >= 2 && p[0] == 5) {
+        int n = p[1];
+        *i += 2;
+        if(n < 16) {
+            return n;
+        }
+        if(n < 232) {                       // A 6x6x6 colour cube
+            static const unsigned char level[6] = { 0, 95, 135, 175, 215, 255 };
+            n -= 16;
+            return terminal_nearest_colour(level[n / 36], level[n / 6 % 6], level[n % 6]);
+        }
+        if(n < 256) {                       // A ramp of 24 greys
+            int grey = 8 + (n - 232) * 10;
+            return terminal_nearest_colour(grey, grey, grey);
+        }
+        return -1;
+    }
+    if(left >= 4 && p[0] == 2) {
+        *i += 4;
+        return terminal_nearest_colour(p[1], p[2], p[3]);
+    }
+    *i = terminal_param_count;              // Not understood, so ignore the rest rather than read them as colours
+    return -1;
+}
+
+// Handle Select Graphic Rendition
+//
+static void terminal_sgr_params(void) {
+    for(int i = 0; i < terminal_param_count; i++) {
+        int n = terminal_params[i];
+        if(n == 38 || n == 48) {            // Extended colours take more parameters, so are dealt with separately
+            int c = terminal_sgr_extended(&i);
+            if(c >= 0) {
+                if(n == 38) {
+                    terminal_sgr.fg = c;
+                }
+                else {
+                    terminal_sgr.bg = c;
+                }
+            }
+        }
+        else if(n == 0) {
+            terminal_sgr = (struct SGR){ .fg = -1, .bg = -1 };
+        }
+        else if(n == 1) {
+            terminal_sgr.bold = true;
+        }
+        else if(n == 7) {
+            terminal_sgr.reverse = true;
+        }
+        else if(n == 22) {
+            terminal_sgr.bold = false;
+        }
+        else if(n == 27) {
+            terminal_sgr.reverse = false;
+        }
+        else if(n >= 30 && n <= 37) {
+            terminal_sgr.fg = n - 30;
+        }
+        else if(n == 39) {
+            terminal_sgr.fg = -1;
+        }
+        else if(n >= 40 && n <= 47) {
+            terminal_sgr.bg = n - 40;
+        }
+        else if(n == 49) {
+            terminal_sgr.bg = -1;
+        }
+        else if(n >= 90 && n <= 97) {
+            terminal_sgr.fg = n - 90 + 8;
+        }
+        else if(n >= 100 && n <= 107) {
+            terminal_sgr.bg = n - 100 + 8;
+        }
+    }
+    terminal_set_colours();
+}
+
+// Handle the final byte of a control sequence
+// - c: The final byte
+//
+static void terminal_csi(unsigned char c) {
+    int p0 = terminal_params[0];
+    int p1 = terminal_params[1];
+    int n = p0 > 0 ? p0 : 1;                // Most sequences take a count that defaults to 1
+    int x = terminal_x < terminal_cols ? terminal_x : terminal_cols - 1;
+    int p = terminal_cell_row(terminal_y);
+
+    if(terminal_private) {                  // Only the cursor visibility is supported of the private modes
+        if((c == 'h' || c == 'l') && p0 == 25) {
+            terminal_cursor_visible = c == 'h';
+        }
+        return;
+    }
+    switch(c) {
+        case 'A':   // Cursor up
+            terminal_goto(x, terminal_y - n);
+            break;
+        case 'B':   // Cursor down
+            terminal_goto(x, terminal_y + n);
+            break;
+        case 'C':   // Cursor forward
+            terminal_goto(x + n, terminal_y);
+            break;
+        case 'D':   // Cursor back
+            terminal_goto(x - n, terminal_y);
+            break;
+        case 'E':   // Cursor to the start of a following line
+            terminal_goto(0, terminal_y + n);
+            break;
+        case 'F':   // Cursor to the start of a previous line
+            terminal_goto(0, terminal_y - n);
+            break;
+        case 'G':   // Cursor to column
+            terminal_goto(n - 1, terminal_y);
+            break;
+        case 'd':   // Cursor to row
+            terminal_goto(x, n - 1);
+            break;
+        case 'H':   // Cursor position
+        case 'f':
+            terminal_goto((p1 > 0 ? p1 : 1) - 1, n - 1);
+            break;
+        case 'J':   // Erase in display
+            if(p0 == 0) {
+                terminal_erase(terminal_y, x, terminal_max_cols - 1);
+                for(int y = terminal_y + 1; y < terminal_rows; y++) {
+                    terminal_erase(y, 0, terminal_max_cols - 1);
+                }
+            }
+            else if(p0 == 1) {
+                for(int y = 0; y < terminal_y; y++) {
+                    terminal_erase(y, 0, terminal_max_cols - 1);
+                }
+                terminal_erase(terminal_y, 0, x);
+            }
+            else {
+                for(int y = 0; y < terminal_rows; y++) {
+                    terminal_erase(y, 0, terminal_max_cols - 1);
+                }
+            }
+            break;
+        case 'K':   // Erase in line
+            terminal_erase(terminal_y, p0 == 0 ? x : 0, p0 == 1 ? x : terminal_max_cols - 1);
+            break;
+        case 'X':   // Erase characters
+            terminal_erase(terminal_y, x, x + n - 1 < terminal_cols - 1 ? x + n - 1 : terminal_cols - 1);
+            break;
+        case '@':   // Insert characters
+        case 'P':   // Delete characters
+            if(n > terminal_cols - x) {
+                n = terminal_cols - x;
+            }
+            if(c == '@') {
+                memmove(&terminal_cells[p][x + n], &terminal_cells[p][x], (terminal_cols - x - n) * sizeof(struct Cell));
+            }
+            else {
+                memmove(&terminal_cells[p][x], &terminal_cells[p][x + n], (terminal_cols - x - n) * sizeof(struct Cell));
+            }
+            for(int i = 0; i < n; i++) {
+                terminal_cells[p][c == '@' ? x + i : terminal_cols - 1 - i] = (struct Cell){ ' ', terminal_fc, terminal_bc };
+            }
+            terminal_damage(p, x, terminal_cols - 1);
+            break;
+        case 'L':   // Insert lines
+        case 'M':   // Delete lines
+            if(terminal_y >= terminal_region_top && terminal_y <= terminal_region_bottom) {
+                terminal_move_rows(terminal_y, terminal_region_bottom, c == 'L' ? -n : n);
+                terminal_x = 0;
+            }
+            break;
+        case 'S':   // Scroll up
+            terminal_move_rows(terminal_region_top, terminal_region_bottom, n);
+            break;
+        case 'T':   // Scroll down
+            terminal_move_rows(terminal_region_top, terminal_region_bottom, -n);
+            break;
+        case 'm':   // Select graphic rendition
+            terminal_sgr_params();
+            break;
+        case 'r':   // Set the scroll region
+            p1 = p1 > 0 && p1 <= terminal_rows ? p1 : terminal_rows;
+            if(n < p1) {
+                terminal_region_top = n - 1;
+                terminal_region_bottom = p1 - 1;
+                terminal_goto(0, 0);
+            }
+            break;
+        case 's':   // Save the cursor
+            terminal_saved = (struct SavedCursor){ terminal_x, terminal_y, terminal_sgr };
+            break;
+        case 'u':   // Restore the cursor
+            terminal_goto(terminal_saved.x, terminal_saved.y);
+            terminal_sgr = terminal_saved.sgr;
+            terminal_set_colours();
+            break;
+    }
+}
+
+// Handle the byte after an ESC
+// - c: The byte
+//
+static void terminal_escape(unsigned char c) {
+    terminal_state = state_normal;
+    switch(c) {
+        case '[':   // Control sequence introducer
+            terminal_state = state_csi;
+            terminal_param_count = 0;
+            terminal_private = false;
+            memset(terminal_params, 0, sizeof(terminal_params));
+            break;
+        case '(':   // Character set selection, which is ignored along with the byte that follows
+        case ')':
+            terminal_state = state_charset;
+            break;
+        case '7':   // Save the cursor
+            terminal_saved = (struct SavedCursor){ terminal_x, terminal_y, terminal_sgr };
+            break;
+        case '8':   // Restore the cursor
+            terminal_goto(terminal_saved.x, terminal_saved.y);
+            terminal_sgr = terminal_saved.sgr;
+            terminal_set_colours();
+            break;
+        case 'D':   // Index
+            lf();
+            break;
+        case 'E':   // Next line
+            cr();
+            lf();
+            break;
+        case 'M':   // Reverse index
+            ri();
+            break;
+        case 'c':   // Reset
+            terminal_reset();
+            break;
+    }
+}
+
+// Output a character to the terminal
+// This only updates the cells; they are drawn by terminal_render
+// - c: The character
+// Returns:
+// - false if it is the code that quits the terminal
+//
+bool terminal_put(unsigned char c) {
+    if(c == 0x03) {                         // Ctrl+C quits the terminal loop
+        return false;
+    }
+    if(c == 0x18 || c == 0x1A) {            // CAN and SUB cancel any sequence
+        terminal_state = state_normal;
+        return true;
+    }
+    if(c == 0x1B) {                         // ESC starts a new one
+        terminal_state = state_escape;
+        return true;
+    }
+    switch(terminal_state) {
+        case state_escape:
+            terminal_escape(c);
+            return true;
+        case state_charset:
+            terminal_state = state_normal;
+            return true;
+        case state_csi:
+            if(c >= '0' && c <= '9') {      // Parameters
+                if(terminal_param_count == 0) {
+                    terminal_param_count = 1;
+                }
+                int * param = &terminal_params[terminal_param_count - 1];
+                if(*param < 10000) {
+                    *param = *param * 10 + c - '0';
+                }
+            }
+            else if(c == ';') {
+                if(terminal_param_count == 0) {
+                    terminal_param_count = 1;
+                }
+                if(terminal_param_count < csi_max_params) {
+                    terminal_param_count++;
+                }
+            }
+            else if(c == '?') {
+                terminal_private = true;
+            }
+            else if(c >= 0x40 && c <= 0x7E) {   // The final byte
+                terminal_state = state_normal;
+                terminal_csi(c);
+            }
+            else if(c < 0x20 || c > 0x2F) {     // Anything but an intermediate byte is an error
+                terminal_state = state_normal;
+            }
+            return true;
+    }
+    if(c >= 32 && c < 127) {                // Output printable characters
+        if(terminal_x >= terminal_cols) {   // Wrap if the last character went in the last column
+            cr();
+            lf();
+        }
+        int p = terminal_cell_row(terminal_y);
+        struct Cell * cell = &terminal_cells[p][terminal_x];
+        if(cell->c != c || cell->fc != terminal_fc || cell->bc != terminal_bc) {
+            *cell = (struct Cell){ c, terminal_fc, terminal_bc };
+            terminal_damage(p, terminal_x, terminal_x);
+        }
+        terminal_x++;
+        return true;
+    }
+    switch(c) {                             // Else deal with the control characters
+        case 0x08:  // Backspace
+            bs();
+            break;
+        case 0x09:  // Tab
+            terminal_goto((terminal_x / 8 + 1) * 8, terminal_y);
+            break;
+        case 0x0A:  // LF, VT and FF
+        case 0x0B:
+        case 0x0C:
+            lf();
+            break;
+        case 0x0D:  // CR
+            cr();
+            break;
+    }
+    return true;
+}
+
+// Read any text waiting for the terminal
+// Input from the serial port is read first, then any text sent by terminal_print
+// - buffer: Buffer for the text
+// - size: Size of the buffer
+// Returns:
+// - Number of bytes read
+//
+static uint32_t terminal_read(unsigned char * buffer, uint32_t size) {
+    uint32_t n = serial_read(buffer, size);
+    return n > 0 ? n : ring_read(&terminal_queue, buffer, size);
+}
+
+// Read everything waiting for the terminal into the cells
+// Returns:
+// - 1 if characters were read, 0 if there were none waiting, -1 if a quit code was received
+//
+int terminal_update(void) {
+    unsigned char buffer[64];
+    uint32_t total = 0;
+    uint32_t n;
+
+    if((n = terminal_read(buffer, sizeof(buffer))) == 0) {
+        return 0;
+    }
+    do {
+        for(uint32_t i = 0; i < n; i++) {
+            if(!terminal_put(buffer[i])) {
+                return -1;
+            }
+        }
+        total += n;                         // Stop at some point if the data keeps coming
+    } while(total < opt_serial_buffer_size && (n = terminal_read(buffer, sizeof(buffer))) > 0);
+    return 1;
+}
+
+// The terminal loop
+// Text is read as it arrives, and drawn once a frame. The core sleeps in between; the serial interrupt and the
+// event sent every vblank wake it up. It quits on Ctrl+C, or when stop_terminal_core1 is called
+//
+void terminal(void) {
+    uint frame = vblank_count;
+
+    terminal_render();
+    while(!terminal_stop && terminal_update() >= 0) {
+        if(frame != vblank_count) {
+            frame = vblank_count;
+            terminal_render();
+        }
+        __wfe();
+    }
+    terminal_render();
+}
+
+// The terminal loop on core 1
+// The serial port is initialised here so that its interrupt is taken by core 1
+//
+void terminal_core1(void) {
+    initialise_serial(opt_terminal_baud);
+    terminal();
+    terminal_running = false;
+    __sev();                                // Wake core 0 if it is waiting in stop_terminal_core1
+}
+
+// Run the terminal on core 1
+// Core 0 can carry on drawing outside of the window. Only core 1 should change the display list while the
+// terminal is running
+// - top: The top pixel row of the terminal window
+// - rows: The height of the window in pixel rows
+//
+void start_terminal_core1(int top, int rows) {
+    ring_init(&terminal_queue, terminal_queue_buffer, sizeof(terminal_queue_buffer));
+    set_terminal_window(top, rows);
+    terminal_stop = false;
+    terminal_running = true;
+    multicore_reset_core1();
+    multicore_launch_core1(terminal_core1);
+}
+
+// Stop the terminal on core 1
+// Core 1 is left to finish what it is doing and quit, so it is never reset while it holds the display lock or
+// is part way through changing the display list
+//
+void stop_terminal_core1(void) {
+    terminal_stop = true;
+    __sev();                                // Wake core 1 so it sees the flag
+    while(terminal_running) {
+        __wfe();
+    }
+    multicore_reset_core1();
+}
+
+// Send text to the terminal from core 0
+// - s: Zero terminated string
+// Returns:
+// - false if there was not enough room in the queue, in which case nothing is sent
+//
+bool terminal_print(const char * s) {
+    return ring_write(&terminal_queue, s, strlen(s));
+}
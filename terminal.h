@@ -2,10 +2,15 @@
 // Title:	        Pico-mposite Terminal Emulation
 // Author:	        Dean Belfield
 // Created:	        19/02/2022
-// Last Updated:	03/03/2022
+// Last Updated:	17/10/2026
 //
 // Modinfo:
 // 03/03/2022:      Added colour
+// 17/10/2026:      Added terminal_put and terminal_update
+// 17/10/2026:      Added terminal windows and the core 1 terminal
+// 17/10/2026:      Added struct Cell, terminal_render and terminal_redraw
+// 17/10/2026:      Added terminal_scroll_down for the ANSI escape sequences
+// 17/10/2026:      terminal_max_rows is now 60 for the interlaced modes
 
 #pragma once
 
@@ -23,5 +28,32 @@
     #define col_terminal_cursor rgb(7,7,7)
 #endif 
 
+#define terminal_queue_size 1024   // Size of the queue for terminal_print; must be a power of two
+
+#define terminal_max_cols   80      // The largest terminal, for a full screen in the 640 pixel wide mode
+#define terminal_max_rows   60      // And for the 480 line interlaced mode
+
+struct Cell {                       // A character cell
+    unsigned char c;                // The character
+    unsigned char fc;               // Foreground colour
+    unsigned char bc;               // Background colour
+};
+
+extern volatile bool terminal_running;
+
 void initialise_terminal(void);
-void terminal(void);
\ No newline at end of file
+void set_terminal_window(int top, int rows);
+void terminal_redraw(void);
+int terminal_row(int y);
+void terminal_scroll_up(void);
+void terminal_scroll_down(void);
+void terminal_render(void);
+
+void terminal(void);
+bool terminal_put(unsigned char c);
+int terminal_update(void);
+
+void terminal_core1(void);
+void start_terminal_core1(int top, int rows);
+void stop_terminal_core1(void);
+bool terminal_print(const char * s);
\ No newline at end of file
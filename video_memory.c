@@ -0,0 +1,126 @@
+//
+// Title:	        Pico-mposite Video Memory
+// Description:		A fixed block of memory for the bitmaps, display lists and sprites
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+// 17/10/2026:      Check opt_video_memory at compile time
+//
+
+#include "pico/stdlib.h"
+
+#include "video_memory.h"
+
+/*
+ * The bitmaps and display lists used to be allocated with malloc on every change of mode, while the video
+ * was running. Now they are laid out in a block of memory reserved at build time, opt_video_memory bytes,
+ * so a change of mode never allocates, never fails half way through, and the memory used for video is
+ * known up front.
+ *
+ * The layout for a mode is worked out first by video_memory_plan, which does not touch anything, so the
+ * caller can check it fits before stopping the video. From the bottom up:
+ *
+ * - The display list and the two line tables
+ * - The front buffer
+ * - The back buffer, if double buffered
+ *
+ * Everything above that is free, and video_memory_alloc hands it out from the top down for sprites, tiles
+ * and the like. These allocations are kept over changes of mode, and a mode only fits if it leaves them
+ * alone; video_memory_release frees them all. As the back buffer is last, double buffering can be turned
+ * on and off without moving anything else
+ */
+
+_Static_assert(opt_video_memory % 4 == 0, "opt_video_memory must be a multiple of 4");
+_Static_assert(opt_video_memory <= 192 * 1024, "opt_video_memory leaves too little RAM for everything else");
+
+static uint32_t video_memory[opt_video_memory / 4];    // Words, so that everything in it is word aligned
+
+static uint32_t video_memory_layout;   // Bytes used by the current layout, from the bottom
+static uint32_t video_memory_top;      // Bytes allocated by video_memory_alloc, from the top
+
+// Round a size up to a whole number of words
+//
+static inline uint32_t video_memory_words(uint32_t size) {
+    return (size + 3) & ~3u;
+}
+
+// Get the bytes needed for a mode
+// - stride: Bytes per row of the bitmap
+// - height: Rows in the bitmap
+// - lines: Visible scanlines; the number of entries in the display list
+// - line_table_length: The number of entries in each line table
+// - double_buffered: True to include a back buffer
+// Returns:
+// - The size in bytes
+//
+uint32_t video_layout_size(int stride, int height, int lines, int line_table_length, bool double_buffered) {
+    uint32_t tables = video_memory_words((lines + 2 * line_table_length) * sizeof(unsigned char *));
+    uint32_t buffer = video_memory_words(stride * height);
+
+    return tables + (double_buffered ? 2 : 1) * buffer;
+}
+
+// Work out the layout for a mode
+// This only fills in the layout; nothing is changed until video_memory_commit is called
+// - layout: Filled in with the addresses of each buffer
+// - The rest as for video_layout_size
+// Returns:
+// - false if the mode does not fit under the memory allocated by video_memory_alloc
+//
+bool video_memory_plan(struct VideoLayout * layout, int stride, int height, int lines, int line_table_length, bool double_buffered) {
+    unsigned char * p = (unsigned char *)video_memory;
+
+    layout->size = video_layout_size(stride, height, lines, line_table_length, double_buffered);
+    if(layout->size > sizeof(video_memory) - video_memory_top) {
+        return false;
+    }
+    layout->display_list = (unsigned char **)p;
+    layout->line_table = layout->display_list + lines;
+    layout->line_table_back = layout->line_table + line_table_length;
+    p += video_memory_words((lines + 2 * line_table_length) * sizeof(unsigned char *));
+    layout->bitmap = p;
+    layout->back = double_buffered ? p + video_memory_words(stride * height) : NULL;
+    return true;
+}
+
+// Start using a layout
+// - layout: The layout, from video_memory_plan
+//
+void video_memory_commit(const struct VideoLayout * layout) {
+    video_memory_layout = layout->size;
+}
+
+// Allocate memory from the top of the video memory
+// The memory is kept until video_memory_release is called, whatever the mode
+// - size: Size in bytes; rounded up to a whole number of words
+// Returns:
+// - Word aligned pointer to the memory, or NULL if there is not enough free
+//
+void * video_memory_alloc(uint32_t size) {
+    size = video_memory_words(size);
+    if(size > video_memory_free()) {
+        return NULL;
+    }
+    video_memory_top += size;
+    return (unsigned char *)video_memory + sizeof(video_memory) - video_memory_top;
+}
+
+// Free everything allocated with video_memory_alloc
+//
+void video_memory_release(void) {
+    video_memory_top = 0;
+}
+
+// Get the bytes in use, by the current mode and video_memory_alloc
+//
+uint32_t video_memory_used(void) {
+    return video_memory_layout + video_memory_top;
+}
+
+// Get the bytes free
+//
+uint32_t video_memory_free(void) {
+    return sizeof(video_memory) - video_memory_used();
+}
@@ -0,0 +1,32 @@
+//
+// Title:	        Pico-mposite Video Memory
+// Author:	        Dean Belfield
+// Created:	        17/10/2026
+// Last Updated:	17/10/2026
+//
+// Modinfo:
+//
+
+#pragma once
+
+#include "pico/stdlib.h"
+
+#include "config.h"
+
+struct VideoLayout {                    // Where the buffers for a mode go in the video memory
+    unsigned char ** display_list;      // The display list being edited, and the two line tables for scan-out
+    unsigned char ** line_table;
+    unsigned char ** line_table_back;
+    unsigned char * bitmap;             // The front buffer
+    unsigned char * back;               // The back buffer, or NULL if not double buffered
+    uint32_t size;                      // The bytes used by all of the above
+};
+
+uint32_t video_layout_size(int stride, int height, int lines, int line_table_length, bool double_buffered);
+bool video_memory_plan(struct VideoLayout * layout, int stride, int height, int lines, int line_table_length, bool double_buffered);
+void video_memory_commit(const struct VideoLayout * layout);
+
+void * video_memory_alloc(uint32_t size);
+void video_memory_release(void);
+uint32_t video_memory_used(void);
+uint32_t video_memory_free(void);